@@ -0,0 +1,74 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Maps a whole set of levels into 0..1 against their own recent history, so quiet rooms and hot
+// line inputs both use the full range without retuning.
+// Each input keeps a decaying maximum and minimum in decibels: a new extreme is taken at once and
+// otherwise each relaxes towards the current level over the horizon. That forgets old material,
+// which a P² quantile estimator never does, and is two values per input with no allocation.
+// Like EnvelopeFollowerBank the state is one array per quantity and updated in a branch free pass.
+class AdaptiveNormaliserBank
+{
+public:
+    struct Settings
+    {
+        float horizon = 10.0f;       // seconds for the range to forget a louder or quieter passage
+        float minimumRange = 24.0f;  // dB, stops steady signals and noise being stretched to full scale
+        float noiseFloor = -80.0f;   // dB relative to full scale, anything this quiet reads as 0
+    };
+
+    explicit AdaptiveNormaliserBank(int maxInputs)
+        : decibels((size_t)maxInputs), maxima((size_t)maxInputs), minima((size_t)maxInputs)
+    {
+    }
+
+    // Not thread safe, call from the thread that calls process
+    void setSettings(const Settings &newSettings) noexcept { settings = newSettings; }
+    const Settings &getSettings() const noexcept { return settings; }
+
+    // Call when the inputs stop meaning the same thing, the next update starts a fresh range
+    void reset() noexcept { primed = false; }
+
+    // Writes num levels mapped to 0..1 from num linear amplitudes, which may be the same array.
+    // interval is the time since the previous call.
+    void process(const float *input, float *output, int num, float interval) noexcept
+    {
+        jassert(num <= (int)decibels.size());
+
+        auto *x = decibels.data();
+        auto *hi = maxima.data();
+        auto *lo = minima.data();
+        auto floor = settings.noiseFloor;
+
+        for (int i = 0; i < num; ++i)
+            x[i] = juce::Decibels::gainToDecibels(input[i], floor);
+
+        if (!primed)
+        {
+            std::copy_n(x, num, hi);
+            std::copy_n(x, num, lo);
+            primed = true;
+        }
+
+        auto decay = settings.horizon > 0.0f ? std::exp(-interval / settings.horizon) : 0.0f;
+        auto minimumRange = settings.minimumRange;
+        auto lowestCeiling = floor + minimumRange;
+
+        for (int i = 0; i < num; ++i)
+        {
+            hi[i] = x[i] > hi[i] ? x[i] : x[i] + decay * (hi[i] - x[i]);
+            lo[i] = x[i] < lo[i] ? x[i] : x[i] + decay * (lo[i] - x[i]);
+
+            // the range hangs from the maximum, which never drops into the noise floor so silence stays dark
+            auto ceiling = juce::jmax(hi[i], lowestCeiling);
+            auto range = juce::jmax(ceiling - lo[i], minimumRange);
+            output[i] = juce::jlimit(0.0f, 1.0f, (x[i] - (ceiling - range)) / range);
+        }
+    }
+
+private:
+    std::vector<float> decibels, maxima, minima;
+    Settings settings;
+    bool primed = false;
+};
@@ -0,0 +1,486 @@
+#include "Analyser.h"
+
+Analyser::Analyser(Listener &l)
+    : juce::Thread("Analysis"), listener(l), audioFifo(audioFifoSize, maxAnalysisChannels),
+      fftData((size_t)(maxAnalysisChannels * STFT::maxSize * 2))
+{
+    for (int order = STFT::minOrder; order <= STFT::maxOrder; ++order)
+        stfts.add(STFT::create(order).release());
+
+    stft = stfts[defaultFFTOrder - STFT::minOrder];
+}
+
+Analyser::~Analyser()
+{
+    stop();
+}
+
+void Analyser::prepare(double newSampleRate, int samplesPerBlockExpected)
+{
+    stop();
+    sampleRate = newSampleRate;
+    samplesAnalysed = 0;
+    bandsNeedRebuilding = true;
+    onsetDetector.reset();
+    descriptors.reset();
+    tempoTracker.reset();
+    pitchDetector.reset();
+    normalisers.reset();
+    envelopes.reset();
+    downmixBuffer.setSize(2, juce::jmax(samplesPerBlockExpected, 512));
+    samplesPushed = 0;
+    loudnessMeter.prepare(sampleRate);
+    slidingDFT.setFrequencies(tracking.frequencies.data(), tracking.bandwidths.data(), tracking.numBins, sampleRate);
+    start();
+}
+
+void Analyser::start()
+{
+    updateConfiguration();
+    startThread();
+}
+
+void Analyser::stop()
+{
+    signalThreadShouldExit();
+    wakeUp.post();
+    stopThread(1000);
+}
+
+void Analyser::setChannelMode(ChannelMode newMode)
+{
+    channelMode = newMode;
+}
+
+void Analyser::setFFTOrder(int newOrder)
+{
+    jassert(newOrder >= STFT::minOrder && newOrder <= STFT::maxOrder);
+    requestedFFTOrder = juce::jlimit(STFT::minOrder, STFT::maxOrder, newOrder);
+    wakeUp.post();
+}
+
+void Analyser::setOverlap(STFT::Overlap newOverlap)
+{
+    requestedOverlap = newOverlap;
+    wakeUp.post();
+}
+
+void Analyser::setWindow(STFT::Window newWindow)
+{
+    requestedWindow = newWindow;
+    wakeUp.post();
+}
+
+void Analyser::setBandLayout(BandAnalyser::Layout newLayout, int numLogBands)
+{
+    requestedNumLogBands = numLogBands;
+    requestedBandLayout = newLayout;
+    bandsNeedRebuilding = true;
+    wakeUp.post();
+}
+
+void Analyser::setBandEngine(BandEngine newEngine, int constantQBinsPerOctave)
+{
+    requestedBinsPerOctave = constantQBinsPerOctave;
+    requestedBandEngine = newEngine;
+    bandsNeedRebuilding = true;
+    wakeUp.post();
+}
+
+void Analyser::setChromaSmoothing(float seconds)
+{
+    requestedChromaSmoothing = juce::jmax(0.0f, seconds);
+}
+
+void Analyser::setSmoothing(const EnvelopeFollowerBank::Times &newTimes)
+{
+    requestedSmoothing.write(newTimes);
+}
+
+void Analyser::setNormalisation(const AdaptiveNormaliserBank::Settings &newSettings)
+{
+    requestedNormalisation.write(newSettings);
+}
+
+void Analyser::setTrackedFrequencies(const TrackedFrequencies &newFrequencies)
+{
+    requestedTracking.write(newFrequencies);
+}
+
+bool Analyser::updateLatestFrame()
+{
+    return frames.update();
+}
+
+const AnalysisFrame &Analyser::getLatestFrame() const
+{
+    return frames.getReadBuffer();
+}
+
+const Analyser::TrackedLevels &Analyser::getTrackedLevels()
+{
+    trackedLevels.update();
+    return trackedLevels.getReadBuffer();
+}
+
+// Audio thread
+void Analyser::pushBlock(const juce::AudioBuffer<float> &buffer, int startSample, int numSamples)
+{
+    // the loudness meter's biquads and the sliding DFT's resonators decay into denormals in silence
+    juce::ScopedNoDenormals noDenormals;
+
+    auto numInputs = juce::jmin(buffer.getNumChannels(), maxAnalysisChannels);
+
+    if (numInputs == 0)
+        return;
+
+    if (requestedTracking.update())
+    {
+        tracking = requestedTracking.getReadBuffer();
+        slidingDFT.setFrequencies(tracking.frequencies.data(), tracking.bandwidths.data(), tracking.numBins, sampleRate);
+    }
+
+    const float *inputs[maxAnalysisChannels];
+
+    for (int channel = 0; channel < numInputs; ++channel)
+        inputs[channel] = buffer.getReadPointer(channel, startSample);
+
+    auto mode = channelMode.load(std::memory_order_relaxed);
+
+    if (mode == ChannelMode::perChannel)
+    {
+        numChannelsInFifo.store(numInputs, std::memory_order_relaxed);
+        audioFifo.push(inputs, numInputs, numSamples);
+        slidingDFT.process(inputs[0], numSamples);
+    }
+    else
+    {
+        // downmix in chunks of the scratch buffer so a bigger than expected block can't allocate
+        auto useMidSide = mode == ChannelMode::midSide && numInputs > 1;
+        auto *mid = downmixBuffer.getWritePointer(0);
+        auto *side = downmixBuffer.getWritePointer(1);
+        const float *lanes[] = {mid, side};
+
+        numChannelsInFifo.store(useMidSide ? 2 : 1, std::memory_order_relaxed);
+
+        for (int done = 0; done < numSamples;)
+        {
+            auto chunk = juce::jmin(numSamples - done, downmixBuffer.getNumSamples());
+
+            if (useMidSide)
+            {
+                juce::FloatVectorOperations::add(mid, inputs[0] + done, inputs[1] + done, chunk);
+                juce::FloatVectorOperations::multiply(mid, 0.5f, chunk);
+                juce::FloatVectorOperations::subtract(side, inputs[0] + done, inputs[1] + done, chunk);
+                juce::FloatVectorOperations::multiply(side, 0.5f, chunk);
+            }
+            else
+            {
+                auto gain = 1.0f / (float)numInputs;
+                juce::FloatVectorOperations::copyWithMultiply(mid, inputs[0] + done, gain, chunk);
+
+                for (int channel = 1; channel < numInputs; ++channel)
+                    juce::FloatVectorOperations::addWithMultiply(mid, inputs[channel] + done, gain, chunk);
+            }
+
+            audioFifo.push(lanes, useMidSide ? 2 : 1, chunk);
+            slidingDFT.process(mid, chunk);
+            done += chunk;
+        }
+    }
+
+    samplesPushed += numSamples;
+
+    // loudness is defined on the real channels, not on whatever the channel mode analyses
+    loudnessMeter.process(inputs, numInputs, numSamples);
+    loudnessSnapshot.write(loudnessMeter.getResult());
+
+    auto &levels = trackedLevels.getWriteBuffer();
+    levels.samplePosition = samplesPushed;
+    levels.numBins = slidingDFT.getNumBins();
+    slidingDFT.getMagnitudes(levels.magnitudes.data());
+    trackedLevels.publish();
+
+    // only wake the worker once there is at least a frame to chew on, and only once until it has
+    // looked. notify() would signal a WaitableEvent, which locks a mutex.
+    if (audioFifo.getNumReady() >= samplesNeededToWake.load(std::memory_order_relaxed)
+        && !frameWaiting.exchange(true, std::memory_order_acq_rel))
+        wakeUp.post();
+}
+
+// Analysis thread
+void Analyser::run()
+{
+    // the filterbank's biquads ring down into denormals in silence
+    juce::ScopedNoDenormals noDenormals;
+
+    while (!threadShouldExit())
+    {
+        updateConfiguration();
+
+        auto numChannels = numChannelsInFifo.load(std::memory_order_relaxed);
+
+        while (audioFifo.getNumReady() >= stft->getSize())
+        {
+            feedNewestHop(numChannels);
+
+            stft->readFrame(audioFifo, numChannels, fftData.data());
+            processFFT(numChannels);
+        }
+
+        // posted by pushBlock, a setter or stop. The flag is cleared before the next pass drains
+        // the fifo, so samples landing during that pass post again instead of waiting for a block.
+        wakeUp.wait();
+        frameWaiting.store(false, std::memory_order_release);
+    }
+}
+
+void Analyser::updateConfiguration()
+{
+    auto engine = requestedBandEngine.load(std::memory_order_relaxed);
+    auto order = requestedFFTOrder.load(std::memory_order_relaxed);
+
+    // the constant-Q kernels need a long frame to resolve the bass
+    if (engine == BandEngine::constantQ)
+        order = juce::jmax(order, ConstantQAnalyser::minFFTOrder);
+
+    if (order != stft->getOrder())
+    {
+        stft = stfts[order - STFT::minOrder];
+        bandsNeedRebuilding = true;
+        onsetDetector.reset();
+        descriptors.reset();
+    }
+
+    auto window = requestedWindow.load(std::memory_order_relaxed);
+
+    if (window != stft->getWindow())
+    {
+        stft->setWindow(window);
+
+        // the constant-Q kernels have the window folded in, the FFT bands correct for its noise bandwidth
+        if (engine == BandEngine::constantQ || engine == BandEngine::fftBands)
+            bandsNeedRebuilding = true;
+    }
+
+    stft->setOverlap(requestedOverlap.load(std::memory_order_relaxed));
+
+    // a frame needs a whole window in the fifo whatever the hop, the fifo keeps the overlap between frames
+    samplesNeededToWake = stft->getSize();
+
+    // the only allocation on this thread, and only when the layout actually changes
+    if (bandsNeedRebuilding.exchange(false))
+    {
+        bandEngine = engine;
+
+        if (bandEngine == BandEngine::constantQ)
+        {
+            constantQAnalyser.prepare(sampleRate, stft->getSize(), requestedBinsPerOctave, stft->getWindowTable());
+            numBands = constantQAnalyser.getNumBands();
+        }
+        else
+        {
+            bandAnalyser.prepare(sampleRate, stft->getSize(), requestedBandLayout, requestedNumLogBands, stft->getWindowTable());
+            numBands = bandAnalyser.getNumBands();
+
+            // the time domain engines only borrow the layout's band edges
+            if (bandEngine == BandEngine::filterbank)
+                filterbank.prepare(sampleRate, bandAnalyser);
+            else if (bandEngine == BandEngine::multiRate)
+                multiRate.prepare(sampleRate, bandAnalyser);
+        }
+
+        // the pitch class of every bin depends on the FFT size
+        chromaAnalyser.prepare(sampleRate, stft->getSize());
+
+        normalisers.reset();
+        envelopes.reset();
+    }
+
+    chromaAnalyser.smoothingTime = requestedChromaSmoothing.load(std::memory_order_relaxed);
+
+    if (requestedNormalisation.update())
+        normalisers.setSettings(requestedNormalisation.getReadBuffer());
+
+    if (requestedSmoothing.update())
+        envelopes.setTimes(requestedSmoothing.getReadBuffer());
+}
+
+// Feeds the newest hop of the frame about to be read to the pitch detector, the zero crossing
+// counter and the time domain engines. Frames advance by a hop, so every sample goes through
+// exactly once.
+void Analyser::feedNewestHop(int numChannels)
+{
+    auto size = stft->getSize(), firstNew = size - stft->getHopSize();
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        audioFifo.peek(channel, size, [this, channel, firstNew](const float *src, int offset, int count)
+                       {
+                           auto skip = juce::jlimit(0, count, firstNew - offset);
+                           src += skip;
+                           count -= skip;
+
+                           if (channel == 0)
+                               pitchDetector.push(src, count);
+
+                           descriptors.countZeroCrossings(channel, src, count);
+
+                           if (bandEngine == BandEngine::filterbank)
+                               filterbank.process(channel, src, count);
+                           else if (bandEngine == BandEngine::multiRate)
+                               multiRate.push(channel, src, count);
+                       });
+}
+
+void Analyser::processFFT(int numChannels)
+{
+    auto &frame = frames.getWriteBuffer();
+
+    // every channel goes through the same FFT and tables, one contiguous row each
+    if (bandEngine == BandEngine::constantQ)
+    {
+        // the kernels need phase, so take the complex spectrum first and make magnitudes after
+        stft->performRealOnlyForwardTransform(fftData.data(), numChannels);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            constantQAnalyser.process(fftData.data() + (size_t)channel * STFT::maxSize * 2, frame.bands[(size_t)channel].data());
+
+        stft->convertToMagnitudes(fftData.data(), numChannels);
+    }
+    else
+    {
+        stft->performFrequencyOnlyForwardTransform(fftData.data(), numChannels);
+    }
+
+    // levels look at the lower half of the spectrum, scaled so a full scale sine reads 1
+    auto numBins = stft->getSize() / 4;
+    auto binScale = 2.0f / (float)stft->getSize();
+
+    if (numChannels != previousNumChannels)
+    {
+        onsetDetector.reset();
+        descriptors.reset();
+        filterbank.reset();
+        multiRate.reset();
+        normalisers.reset();
+        envelopes.reset();
+        previousNumChannels = numChannels;
+    }
+
+    frame.samplePosition = samplesAnalysed;
+    frame.sampleRate = sampleRate;
+    frame.fftSize = stft->getSize();
+    frame.hopSize = stft->getHopSize();
+    frame.numChannels = numChannels;
+    frame.numBands = numBands;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto *row = fftData.data() + (size_t)channel * STFT::maxSize * 2;
+
+        frame.channelLevels[(size_t)channel] = juce::FloatVectorOperations::findMaximum(row, numBins) * binScale;
+        frame.descriptors[(size_t)channel] = descriptors.process(channel, row, stft->getNumBins(), stft->getSize(), sampleRate);
+
+        if (channel == 0)
+            fillSpectrum(frame, row, binScale);
+
+        auto *bands = frame.bands[(size_t)channel].data();
+        auto *peaks = frame.bandPeaks[(size_t)channel].data();
+
+        if (bandEngine == BandEngine::filterbank)
+        {
+            filterbank.getLevels(channel, bands, peaks);
+        }
+        else
+        {
+            if (bandEngine == BandEngine::fftBands)
+                bandAnalyser.process(row, bands);
+            else if (bandEngine == BandEngine::multiRate)
+                multiRate.process(channel, bands);
+
+            // a spectrum has no time structure finer than the frame
+            std::copy_n(bands, frame.numBands, peaks);
+        }
+    }
+
+    frame.onset = onsetDetector.process(fftData.data(), (size_t)STFT::maxSize * 2, numChannels, stft->getNumBins(), stft->getSize(),
+                                        samplesAnalysed + stft->getSize() / 2, stft->getHopSize(), sampleRate);
+    onsetCount += frame.onset.isOnset ? 1 : 0;
+    frame.onsetCount = onsetCount;
+    frame.tempo = tempoTracker.process(frame.onset.flux, samplesAnalysed + stft->getSize() / 2, sampleRate);
+
+    frame.pitch = pitchDetector.process(sampleRate);
+    frame.chroma = chromaAnalyser.process(fftData.data(), (size_t)STFT::maxSize * 2, numChannels,
+                                          (float)(stft->getHopSize() / sampleRate));
+
+    loudnessSnapshot.update();
+    frame.loudness = loudnessSnapshot.getReadBuffer();
+
+    normaliseFeatures(frame);
+    smoothFeatures(frame);
+
+    samplesAnalysed += stft->getHopSize();
+
+    listener.analysisFrameReady(frame);
+    frames.publish();
+}
+
+// Squeezes however many bins the FFT has into numSpectrumPoints, repeating bins when there are fewer
+void Analyser::fillSpectrum(AnalysisFrame &frame, const float *magnitudes, float binScale)
+{
+    auto numBins = stft->getNumBins();
+
+    for (int i = 0; i < numSpectrumPoints; ++i)
+    {
+        auto first = i * numBins / numSpectrumPoints;
+        auto end = juce::jmax(first + 1, (i + 1) * numBins / numSpectrumPoints);
+
+        frame.spectrum[(size_t)i] = juce::FloatVectorOperations::findMaximum(magnitudes + first, end - first) * binScale;
+    }
+}
+
+// Replaces the raw channel levels with normalised ones and fills in normalisedBands and peakLevel
+void Analyser::normaliseFeatures(AnalysisFrame &frame)
+{
+    auto *levels = featureScratch.data();
+    auto numChannels = frame.numChannels;
+    auto num = numChannels;
+
+    std::copy_n(frame.channelLevels.data(), numChannels, levels);
+
+    for (int channel = 0; channel < numChannels; ++channel, num += numBands)
+        std::copy_n(frame.bands[(size_t)channel].data(), numBands, levels + num);
+
+    normalisers.process(levels, levels, num, (float)(frame.hopSize / sampleRate));
+
+    std::copy_n(levels, numChannels, frame.channelLevels.data());
+    frame.peakLevel = juce::FloatVectorOperations::findMaximum(levels, numChannels);
+
+    for (int channel = 0, offset = numChannels; channel < numChannels; ++channel, offset += numBands)
+        std::copy_n(levels + offset, numBands, frame.normalisedBands[(size_t)channel].data());
+}
+
+void Analyser::smoothFeatures(AnalysisFrame &frame)
+{
+    auto *input = featureScratch.data();
+    int num = 0;
+
+    input[num++] = frame.peakLevel;
+
+    for (int channel = 0; channel < frame.numChannels; ++channel, num += numBands)
+        std::copy_n(frame.normalisedBands[(size_t)channel].data(), numBands, input + num);
+
+    envelopes.process(input, num, (float)(frame.hopSize / sampleRate));
+
+    auto *smoothed = envelopes.getEnvelopes();
+    auto *held = envelopes.getPeaks();
+
+    frame.smoothedPeakLevel = smoothed[0];
+    frame.heldPeakLevel = held[0];
+
+    for (int channel = 0, offset = 1; channel < frame.numChannels; ++channel, offset += numBands)
+    {
+        std::copy_n(smoothed + offset, numBands, frame.smoothedBands[(size_t)channel].data());
+        std::copy_n(held + offset, numBands, frame.heldBands[(size_t)channel].data());
+    }
+}
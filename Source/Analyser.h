@@ -0,0 +1,223 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "LockFree.h"
+#include "STFT.h"
+#include "BandAnalyser.h"
+#include "ConstantQAnalyser.h"
+#include "FilterbankAnalyser.h"
+#include "MultiRateAnalyser.h"
+#include "OnsetDetector.h"
+#include "TempoTracker.h"
+#include "EnvelopeFollower.h"
+#include "AdaptiveNormaliser.h"
+#include "SlidingDFT.h"
+#include "LoudnessMeter.h"
+#include "PitchDetector.h"
+#include "ChromaAnalyser.h"
+#include "SpectralDescriptors.h"
+
+static constexpr int maxAnalysisChannels = 16;
+static constexpr int numSpectrumPoints = 512; // width of AnalysisFrame::spectrum whatever the FFT size
+
+// Features extracted from one STFT frame
+struct AnalysisFrame
+{
+    juce::int64 samplePosition = 0; // stream position of the first sample in the frame, counted from prepare
+    double sampleRate = 44100.0;
+    int fftSize = 0, hopSize = 0;
+
+    int numChannels = 0;
+    std::array<float, maxAnalysisChannels> channelLevels{}; // loudest bin of each analysed channel, normalised to 0..1
+    float peakLevel = 0.0f;                                 // loudest of the channel levels
+
+    // first analysed channel, 0 Hz to Nyquist in equal slices each holding its loudest bin, full scale sine reads 1
+    std::array<float, numSpectrumPoints> spectrum{};
+
+    int numBands = 0;
+    std::array<std::array<float, maxAnalysisBands>, maxAnalysisChannels> bands{};           // amplitude per band, per channel, a full scale sine in a band reads 1
+    std::array<std::array<float, maxAnalysisBands>, maxAnalysisChannels> bandPeaks{};       // filterbank peak amplitude over the hop, otherwise bands
+    std::array<std::array<float, maxAnalysisBands>, maxAnalysisChannels> normalisedBands{}; // the same mapped to 0..1, see setNormalisation
+
+    OnsetDetector::Result onset;
+    int onsetCount = 0; // running total, lets readers that skip frames tell an onset went by
+    TempoTracker::Result tempo;
+    LoudnessMeter::Result loudness; // as of the latest audio block, measured on the raw inputs
+    PitchDetector::Result pitch;    // of the first analysed channel, up to the end of the frame
+    ChromaAnalyser::Result chroma;  // summed over the analysed channels
+    std::array<SpectralDescriptors::Result, maxAnalysisChannels> descriptors{}; // per analysed channel
+
+    // peakLevel and normalisedBands through attack/release followers, see Analyser::setSmoothing
+    float smoothedPeakLevel = 0.0f, heldPeakLevel = 0.0f;
+    std::array<std::array<float, maxAnalysisBands>, maxAnalysisChannels> smoothedBands{}, heldBands{};
+};
+
+// Runs the FFT and feature extraction on its own thread.
+// The audio thread writes whole blocks and wakes the worker once a frame's worth is waiting,
+// each frame is built in place in a triple buffer that any one reader picks up with updateLatestFrame.
+class Analyser : private juce::Thread
+{
+public:
+    struct Listener
+    {
+        virtual ~Listener() = default;
+
+        // Called on the analysis thread just before the frame is published, don't block or keep the reference
+        virtual void analysisFrameReady(const AnalysisFrame &) = 0;
+    };
+
+    enum class BandEngine
+    {
+        fftBands,   // BandAnalyser over the STFT magnitudes, laid out by setBandLayout
+        constantQ,  // ConstantQAnalyser kernels on the complex STFT, which runs at ConstantQAnalyser::minFFTOrder or above
+        filterbank, // FilterbankAnalyser biquads laid out by setBandLayout, lower latency but coarser
+        multiRate   // MultiRateAnalyser octaves laid out by setBandLayout, finer in the bass but slower to respond
+    };
+
+    enum class ChannelMode
+    {
+        mono,       // all inputs summed into one spectrum
+        perChannel, // one spectrum per input, up to maxAnalysisChannels
+        midSide     // (L + R) / 2 and (L - R) / 2 of the first two inputs
+    };
+
+    // Frequencies followed sample by sample on the audio thread, see setTrackedFrequencies
+    struct TrackedFrequencies
+    {
+        int numBins = 0;
+        std::array<float, SlidingDFTBank::maxBins> frequencies{}, bandwidths{}; // Hz
+    };
+
+    struct TrackedLevels
+    {
+        juce::int64 samplePosition = 0; // stream position just after the last sample tracked
+        int numBins = 0;
+        std::array<float, SlidingDFTBank::maxBins> magnitudes{}; // full scale sine reads 1
+    };
+
+    explicit Analyser(Listener &);
+    ~Analyser() override;
+
+    // Allocates scratch space and (re)starts the worker, call before audio starts
+    void prepare(double newSampleRate, int samplesPerBlockExpected);
+    void start();
+    void stop();
+
+    // Safe from any thread, a frame straddling the switch may mix both modes
+    void setChannelMode(ChannelMode);
+
+    // Safe from any thread, picks one of the prebuilt FFT sizes from STFT::minOrder to STFT::maxOrder.
+    // The worker switches before its next frame, nothing is allocated.
+    void setFFTOrder(int);
+
+    // Safe from any thread, the worker switches before its next frame
+    void setOverlap(STFT::Overlap);
+    void setWindow(STFT::Window);
+
+    // Safe from any thread, the worker rebuilds its bin to band table before the next frame.
+    // numLogBands is only used by BandAnalyser::Layout::logSpaced.
+    void setBandLayout(BandAnalyser::Layout, int numLogBands = 64);
+
+    // Safe from any thread, picks what fills AnalysisFrame::bands. The worker rebuilds before the next frame.
+    void setBandEngine(BandEngine, int constantQBinsPerOctave = 12);
+
+    // Call from one thread at a time, the worker picks the new times up before its next frame
+    void setSmoothing(const EnvelopeFollowerBank::Times &);
+
+    // Call from one thread at a time, the worker picks the new settings up before its next frame
+    void setNormalisation(const AdaptiveNormaliserBank::Settings &);
+
+    // Safe from any thread, seconds of smoothing on AnalysisFrame::chroma, 0 for none
+    void setChromaSmoothing(float);
+
+    // Call from one thread at a time. The audio thread runs a sliding DFT at these frequencies over the
+    // first analysed channel from its next block on, for a few bins that can't wait for the next FFT.
+    void setTrackedFrequencies(const TrackedFrequencies &);
+
+    // Call from one thread at a time, the tracked levels as of the latest audio block
+    const TrackedLevels &getTrackedLevels();
+
+    // Call from one thread at a time, picks up the newest frame and returns true if it's new
+    bool updateLatestFrame();
+    const AnalysisFrame &getLatestFrame() const;
+
+    // Audio thread
+    void pushBlock(const juce::AudioBuffer<float> &, int startSample, int numSamples);
+
+    enum
+    {
+        defaultFFTOrder = 10,
+        audioFifoSize = 1 << 16, // ~1.5s at 44.1kHz of slack before the audio thread has to drop samples
+    };
+
+private:
+    void run() override;
+    void updateConfiguration();
+    void feedNewestHop(int numChannels);
+    void processFFT(int numChannels);
+    void fillSpectrum(AnalysisFrame &, const float *magnitudes, float binScale);
+    void normaliseFeatures(AnalysisFrame &);
+    void smoothFeatures(AnalysisFrame &);
+
+    Listener &listener;
+    double sampleRate = 44100.0;
+
+    SpscRingBuffer<float> audioFifo; // one lane per analysed channel
+    std::atomic<int> samplesNeededToWake{1};
+    WakeUpSemaphore wakeUp;                // the worker sleeps on this, the audio thread can't take the lock inside notify()
+    std::atomic<bool> frameWaiting{false}; // set with each post from the audio thread, so a slow worker isn't posted once per block
+    std::atomic<int> numChannelsInFifo{0};
+    std::atomic<ChannelMode> channelMode{ChannelMode::mono};
+    juce::AudioBuffer<float> downmixBuffer; // audio thread scratch for mono and mid/side
+
+    TripleBuffer<TrackedFrequencies> requestedTracking;
+    TrackedFrequencies tracking; // audio thread copy
+    SlidingDFTBank slidingDFT;
+    TripleBuffer<TrackedLevels> trackedLevels;
+    juce::int64 samplesPushed = 0;
+
+    LoudnessMeter loudnessMeter{maxAnalysisChannels};
+    TripleBuffer<LoudnessMeter::Result> loudnessSnapshot;
+
+    juce::OwnedArray<STFT> stfts; // one per order, built up front so switching never allocates
+    STFT *stft = nullptr;
+    std::atomic<int> requestedFFTOrder{defaultFFTOrder};
+    std::atomic<STFT::Overlap> requestedOverlap{STFT::Overlap::threeQuarters};
+    std::atomic<STFT::Window> requestedWindow{STFT::Window::hann};
+    std::atomic<BandAnalyser::Layout> requestedBandLayout{BandAnalyser::Layout::thirdOctave};
+    std::atomic<int> requestedNumLogBands{64};
+    std::atomic<BandEngine> requestedBandEngine{BandEngine::fftBands};
+    std::atomic<int> requestedBinsPerOctave{12};
+    std::atomic<bool> bandsNeedRebuilding{true};
+    std::vector<float> fftData; // one row of STFT::maxSize * 2 per channel to account for real and complex components
+    juce::int64 samplesAnalysed = 0;
+    int previousNumChannels = 0;
+
+    BandEngine bandEngine = BandEngine::fftBands;
+    BandAnalyser bandAnalyser;
+    ConstantQAnalyser constantQAnalyser;
+    FilterbankAnalyser filterbank{maxAnalysisChannels};
+    MultiRateAnalyser multiRate{maxAnalysisChannels};
+    PitchDetector pitchDetector;
+    ChromaAnalyser chromaAnalyser;
+    std::atomic<float> requestedChromaSmoothing{0.0f};
+    SpectralDescriptors descriptors{maxAnalysisChannels, STFT::maxSize / 2 + 1};
+    OnsetDetector onsetDetector{maxAnalysisChannels, STFT::maxSize / 2 + 1};
+    TempoTracker tempoTracker;
+
+    // normalisers are laid out as one level per channel then numBands per channel, packed
+    AdaptiveNormaliserBank normalisers{maxAnalysisChannels + maxAnalysisChannels * maxAnalysisBands};
+    TripleBuffer<AdaptiveNormaliserBank::Settings> requestedNormalisation;
+
+    // followers are laid out as peakLevel then numBands per channel, packed
+    EnvelopeFollowerBank envelopes{1 + maxAnalysisChannels * maxAnalysisBands};
+    TripleBuffer<EnvelopeFollowerBank::Times> requestedSmoothing;
+
+    std::vector<float> featureScratch = std::vector<float>((size_t)(maxAnalysisChannels + maxAnalysisChannels * maxAnalysisBands));
+
+    // frames are filled straight into the write buffer, so only what lasts across frames lives here
+    TripleBuffer<AnalysisFrame> frames;
+    int numBands = 0, onsetCount = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Analyser)
+};
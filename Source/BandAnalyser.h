@@ -0,0 +1,137 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "VectorOps.h"
+
+static constexpr int maxAnalysisBands = 256;
+
+// Reduces a magnitude spectrum to logarithmically spaced bands.
+// Each band is a contiguous run of bins with precomputed weights, so a frame costs one short
+// weighted sum of squares per band. Bands are measured as power corrected for the window's noise
+// bandwidth, like MultiRateAnalyser, so a tone inside a band reads its amplitude at any FFT size and
+// on the same scale as the other engines, and noise reads the same whatever the FFT size.
+// Call prepare whenever the sample rate, FFT size, window or layout changes.
+class BandAnalyser
+{
+public:
+    enum class Layout
+    {
+        octave,      // ISO centres from 31.5 Hz
+        thirdOctave, // ISO centres from 25 Hz
+        logSpaced    // numLogBands bands spread evenly in log frequency
+    };
+
+    struct Band
+    {
+        float lowFrequency, centreFrequency, highFrequency;
+        int firstBin, numBins, weightOffset;
+    };
+
+    static constexpr float minFrequency = 20.0f, maxFrequency = 20000.0f;
+
+    // window is the fftSize point window the magnitudes were taken through
+    void prepare(double sampleRate, int fftSize, Layout newLayout, int numLogBands, const float *window)
+    {
+        bands.clear();
+        weights.clear();
+
+        // equivalent noise bandwidth in bins, how far the window smears one tone's power
+        double sumOfWindow = 0.0, sumOfSquares = 0.0;
+
+        for (int i = 0; i < fftSize; ++i)
+        {
+            sumOfWindow += window[i];
+            sumOfSquares += (double)window[i] * window[i];
+        }
+
+        noiseBandwidth = fftSize * sumOfSquares / (sumOfWindow * sumOfWindow);
+
+        auto nyquist = (float)(sampleRate / 2.0);
+        auto topFrequency = juce::jmin(maxFrequency, nyquist);
+
+        if (newLayout == Layout::logSpaced)
+        {
+            numLogBands = juce::jlimit(1, maxAnalysisBands, numLogBands);
+            auto ratio = std::pow(topFrequency / minFrequency, 1.0f / (float)numLogBands);
+
+            for (int i = 0; i < numLogBands; ++i)
+            {
+                auto low = minFrequency * std::pow(ratio, (float)i);
+                addBand(low, low * std::sqrt(ratio), low * ratio, sampleRate, fftSize);
+            }
+        }
+        else
+        {
+            // base 2 ISO 266 centres relative to 1 kHz
+            auto bandsPerOctave = newLayout == Layout::octave ? 1 : 3;
+            auto halfWidth = std::pow(2.0f, 0.5f / (float)bandsPerOctave);
+
+            for (int i = -6 * bandsPerOctave; (int)bands.size() < maxAnalysisBands; ++i)
+            {
+                auto centre = 1000.0f * std::pow(2.0f, (float)i / (float)bandsPerOctave);
+
+                if (centre * halfWidth > topFrequency)
+                    break;
+
+                if (centre >= minFrequency)
+                    addBand(centre / halfWidth, centre, centre * halfWidth, sampleRate, fftSize);
+            }
+        }
+    }
+
+    int getNumBands() const noexcept { return (int)bands.size(); }
+    const Band &getBand(int index) const noexcept { return bands[(size_t)index]; }
+
+    // Writes getNumBands() band levels from the first fftSize / 2 + 1 magnitudes, a full scale sine reads 1
+    void process(const float *magnitudes, float *bandLevels) const noexcept
+    {
+        for (size_t i = 0; i < bands.size(); ++i)
+        {
+            auto &band = bands[i];
+            bandLevels[i] = std::sqrt(VectorOps::weightedSumOfSquares(magnitudes + band.firstBin, weights.data() + band.weightOffset, band.numBins));
+        }
+    }
+
+private:
+    std::vector<Band> bands;
+    std::vector<float> weights;
+    double noiseBandwidth = 1.5; // bins, Hann's
+
+    // Each bin covers [k - 0.5, k + 0.5] bin widths and is weighted by the fraction of that inside the band,
+    // times the 2 / fftSize amplitude scale squared over the window's noise bandwidth, which undoes the
+    // smearing so a tone's bins add back up to its amplitude squared.
+    void addBand(float low, float centre, float high, double sampleRate, int fftSize)
+    {
+        auto binWidth = (float)(sampleRate / fftSize);
+        auto lastBin = fftSize / 2;
+
+        auto firstBin = juce::jlimit(0, lastBin, (int)std::floor(low / binWidth + 0.5f));
+        auto endBin = juce::jlimit(firstBin + 1, lastBin + 1, (int)std::ceil(high / binWidth + 0.5f));
+
+        Band band{low, centre, high, firstBin, endBin - firstBin, (int)weights.size()};
+        double total = 0.0;
+
+        for (int k = firstBin; k < endBin; ++k)
+        {
+            auto overlap = juce::jmin(high, ((float)k + 0.5f) * binWidth) - juce::jmax(low, ((float)k - 0.5f) * binWidth);
+            weights.push_back(juce::jmax(0.0f, overlap) / binWidth);
+            total += weights.back();
+        }
+
+        auto binScale = 2.0 / fftSize;
+        auto scale = (float)(binScale * binScale / noiseBandwidth);
+
+        // narrower than a bin and between bin centres, fall back to the nearest bin's own amplitude
+        if (total <= 0.0)
+        {
+            std::fill(weights.begin() + band.weightOffset, weights.end(), 0.0f);
+            weights[(size_t)band.weightOffset] = 1.0f;
+            scale = (float)(binScale * binScale);
+        }
+
+        for (auto i = (size_t)band.weightOffset; i < weights.size(); ++i)
+            weights[i] *= scale;
+
+        bands.push_back(band);
+    }
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Twelve bin chroma vector and key estimate from a magnitude spectrum.
+// Every bin narrow enough to resolve a semitone is shared between its two nearest pitch classes
+// with cos^2 weights, which sum to one wherever the bin falls, so a detuned note moves smoothly
+// between classes instead of flipping. The weights are precomputed as a sparse list of
+// (bin, class, weight) entries, so a frame is one pass over that list.
+// The key is the major or minor Krumhansl-Kessler profile that correlates best with the chroma.
+class ChromaAnalyser
+{
+public:
+    static constexpr int numPitchClasses = 12;
+    static constexpr float minFrequency = 55.0f, maxFrequency = 5000.0f;
+    static constexpr float referenceFrequency = 440.0f; // A, pitch class 9 with C as 0
+
+    struct Result
+    {
+        std::array<float, numPitchClasses> chroma{}; // C to B, loudest class is 1
+        int key = -1;                                // 0 to 11 major C to B, 12 to 23 minor, -1 for silence
+        float keyStrength = 0.0f;                    // correlation with that key's profile, -1..1
+    };
+
+    float smoothingTime = 0.0f; // seconds of one pole smoothing on the chroma, 0 for none
+
+    ChromaAnalyser()
+    {
+        static constexpr float major[] = {6.35f, 2.23f, 3.48f, 2.33f, 4.38f, 4.09f, 2.52f, 5.19f, 2.39f, 3.66f, 2.29f, 2.88f};
+        static constexpr float minor[] = {6.33f, 2.68f, 3.52f, 5.38f, 2.60f, 3.53f, 2.54f, 4.75f, 3.98f, 2.69f, 3.34f, 3.17f};
+
+        // every rotation, centred and scaled to unit length so a dot product is the correlation
+        for (int tonic = 0; tonic < numPitchClasses; ++tonic)
+            for (int pc = 0; pc < numPitchClasses; ++pc)
+            {
+                auto degree = (pc - tonic + numPitchClasses) % numPitchClasses;
+                profiles[(size_t)tonic][(size_t)pc] = major[degree];
+                profiles[(size_t)(tonic + numPitchClasses)][(size_t)pc] = minor[degree];
+            }
+
+        for (auto &profile : profiles)
+            standardise(profile);
+    }
+
+    void prepare(double sampleRate, int fftSize)
+    {
+        entries.clear();
+
+        auto binWidth = sampleRate / fftSize;
+        auto semitoneRatio = std::pow(2.0, 1.0 / 12.0) - 1.0;
+
+        for (int bin = 1; bin <= fftSize / 2; ++bin)
+        {
+            auto frequency = bin * binWidth;
+
+            // a bin wider than a semitone can't say which note it holds
+            if (frequency < minFrequency || frequency > maxFrequency || binWidth > frequency * semitoneRatio)
+                continue;
+
+            // semitones above the nearest C below, where C sits 9 semitones under A
+            auto semitones = 12.0 * std::log2(frequency / referenceFrequency) + 9.0;
+            auto lower = (int)std::floor(semitones);
+            auto fraction = semitones - lower;
+            auto toUpper = std::sin(juce::MathConstants<double>::halfPi * fraction);
+
+            entries.push_back({bin, wrap(lower), (float)(1.0 - toUpper * toUpper)});
+            entries.push_back({bin, wrap(lower + 1), (float)(toUpper * toUpper)});
+        }
+
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        smoothed.fill(0.0f);
+        result = {};
+    }
+
+    // rows holds numChannels magnitude spectra rowStride apart, interval is the time since the last call
+    const Result &process(const float *rows, size_t rowStride, int numChannels, float interval) noexcept
+    {
+        std::array<float, numPitchClasses> chroma{};
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto *magnitudes = rows + (size_t)channel * rowStride;
+
+            for (auto &entry : entries)
+                chroma[(size_t)entry.pitchClass] += entry.weight * magnitudes[entry.bin];
+        }
+
+        auto coefficient = smoothingTime > 0.0f ? std::exp(-interval / smoothingTime) : 0.0f;
+
+        for (size_t pc = 0; pc < chroma.size(); ++pc)
+            smoothed[pc] = chroma[pc] + coefficient * (smoothed[pc] - chroma[pc]);
+
+        auto loudest = *std::max_element(smoothed.begin(), smoothed.end());
+
+        if (loudest <= 1.0e-9f)
+            return result = {};
+
+        for (size_t pc = 0; pc < chroma.size(); ++pc)
+            result.chroma[pc] = smoothed[pc] / loudest;
+
+        auto centred = result.chroma;
+        standardise(centred);
+
+        result.key = 0;
+        result.keyStrength = -1.0f;
+
+        for (size_t key = 0; key < profiles.size(); ++key)
+        {
+            auto correlation = std::inner_product(centred.begin(), centred.end(), profiles[key].begin(), 0.0f);
+
+            if (correlation > result.keyStrength)
+            {
+                result.keyStrength = correlation;
+                result.key = (int)key;
+            }
+        }
+
+        return result;
+    }
+
+private:
+    struct Entry
+    {
+        int bin, pitchClass;
+        float weight;
+    };
+
+    std::vector<Entry> entries; // in bin order, so the spectrum is read front to back
+    std::array<std::array<float, numPitchClasses>, numPitchClasses * 2> profiles{};
+    std::array<float, numPitchClasses> smoothed{};
+    Result result;
+
+    static int wrap(int semitones) noexcept { return ((semitones % numPitchClasses) + numPitchClasses) % numPitchClasses; }
+
+    // zero mean and unit length
+    static void standardise(std::array<float, numPitchClasses> &v) noexcept
+    {
+        auto mean = std::accumulate(v.begin(), v.end(), 0.0f) / (float)numPitchClasses;
+
+        for (auto &x : v)
+            x -= mean;
+
+        auto length = std::sqrt(std::inner_product(v.begin(), v.end(), v.begin(), 0.0f));
+
+        for (auto &x : v)
+            x = length > 0.0f ? x / length : 0.0f;
+    }
+};
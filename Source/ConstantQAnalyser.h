@@ -0,0 +1,139 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "VectorOps.h"
+#include "BandAnalyser.h"
+
+// Constant-Q bands from one large FFT, after Brown and Puckette's sparse spectral kernel.
+// Each band's temporal kernel is a windowed complex exponential Q cycles long, centred in the frame.
+// Its spectrum is precomputed and cut down to the short run of bins above a threshold, so a frame
+// costs one complex dot product per band on the spectrum the STFT already made.
+// Kernels longer than the FFT are cut to fit, so the lowest bands trade some Q for staying in step
+// with the other analysers. Bands are reported through the same Band struct as BandAnalyser.
+class ConstantQAnalyser
+{
+public:
+    using Band = BandAnalyser::Band;
+
+    static constexpr float minFrequency = 32.703196f; // C1, so bands land on equal tempered notes
+    static constexpr int minFFTOrder = 13;            // keeps the kernels below 100 Hz near full length
+
+    // stftWindow is the window the frames were read with, fftSize values
+    void prepare(double sampleRate, int fftSize, int binsPerOctave, const float *stftWindow)
+    {
+        bands.clear();
+        realWeights.clear();
+        imagWeights.clear();
+
+        binsPerOctave = juce::jlimit(1, 48, binsPerOctave);
+
+        auto q = 1.0 / (std::pow(2.0, 1.0 / binsPerOctave) - 1.0);
+        auto topFrequency = juce::jmin((double)BandAnalyser::maxFrequency, sampleRate * 0.45);
+        auto halfWidth = std::pow(2.0, 0.5 / binsPerOctave);
+
+        juce::dsp::FFT fft(juce::roundToInt(std::log2(fftSize)));
+        std::vector<juce::dsp::Complex<float>> kernel((size_t)fftSize), spectrum((size_t)fftSize);
+
+        for (int i = 0; (int)bands.size() < maxAnalysisBands; ++i)
+        {
+            auto centre = minFrequency * std::pow(2.0, (double)i / binsPerOctave);
+
+            if (centre * halfWidth > topFrequency)
+                break;
+
+            auto length = juce::jlimit(2, fftSize, (int)std::ceil(q * sampleRate / centre));
+            makeTemporalKernel(kernel, centre / sampleRate, length, stftWindow);
+            fft.perform(kernel.data(), spectrum.data(), false);
+
+            addBand((float)(centre / halfWidth), (float)centre, (float)(centre * halfWidth), spectrum, fftSize);
+        }
+    }
+
+    int getNumBands() const noexcept { return (int)bands.size(); }
+    const Band &getBand(int index) const noexcept { return bands[(size_t)index]; }
+
+    // Writes getNumBands() band amplitudes from a spectrum left by STFT::performRealOnlyForwardTransform
+    void process(const float *spectrum, float *bandLevels) const noexcept
+    {
+        for (size_t i = 0; i < bands.size(); ++i)
+        {
+            auto &band = bands[i];
+            auto *bins = spectrum + 2 * band.firstBin;
+            auto length = 2 * band.numBins;
+
+            auto re = VectorOps::dotProduct(bins, realWeights.data() + band.weightOffset, length);
+            auto im = VectorOps::dotProduct(bins, imagWeights.data() + band.weightOffset, length);
+            bandLevels[i] = std::sqrt(re * re + im * im);
+        }
+    }
+
+private:
+    // spectral kernel values below this fraction of a kernel's peak are dropped
+    static constexpr float sparsity = 0.0054f;
+
+    std::vector<Band> bands;
+
+    // conj(K) laid out to match the interleaved spectrum, so both parts of the complex product
+    // are plain dot products: re = Xr Kr + Xi Ki, im = Xi Kr - Xr Ki
+    std::vector<float> realWeights, imagWeights;
+
+    // Hann windowed exp(i 2 pi f n) centred in the frame, scaled so that after the STFT window
+    // a full scale sine at f reads 1
+    static void makeTemporalKernel(std::vector<juce::dsp::Complex<float>> &kernel, double normalisedFrequency,
+                                   int length, const float *stftWindow)
+    {
+        auto size = (int)kernel.size();
+        auto start = (size - length) / 2;
+        double gain = 0.0;
+
+        std::fill(kernel.begin(), kernel.end(), juce::dsp::Complex<float>());
+
+        for (int n = 0; n < length; ++n)
+        {
+            auto w = 0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * (n + 0.5) / length);
+            auto phase = juce::MathConstants<double>::twoPi * normalisedFrequency * (start + n);
+
+            auto value = std::polar(w, phase);
+
+            kernel[(size_t)(start + n)] = {(float)value.real(), (float)value.imag()};
+            gain += w * stftWindow[start + n];
+        }
+
+        // Parseval's 1 / N and the factor of two from only seeing the positive frequencies
+        auto scale = (float)(2.0 / (gain * size));
+
+        for (auto &k : kernel)
+            k *= scale;
+    }
+
+    // Keeps the contiguous run of bins from the first to the last above the sparsity threshold
+    void addBand(float low, float centre, float high, const std::vector<juce::dsp::Complex<float>> &spectrum, int fftSize)
+    {
+        auto lastBin = fftSize / 2;
+        float peak = 0.0f;
+
+        for (int k = 0; k <= lastBin; ++k)
+            peak = juce::jmax(peak, std::abs(spectrum[(size_t)k]));
+
+        auto threshold = sparsity * peak;
+        auto firstBin = 0, endBin = lastBin + 1;
+
+        while (firstBin < lastBin && std::abs(spectrum[(size_t)firstBin]) < threshold)
+            ++firstBin;
+
+        while (endBin > firstBin + 1 && std::abs(spectrum[(size_t)endBin - 1]) < threshold)
+            --endBin;
+
+        bands.push_back({low, centre, high, firstBin, endBin - firstBin, (int)realWeights.size()});
+
+        for (int k = firstBin; k < endBin; ++k)
+        {
+            auto kr = spectrum[(size_t)k].real(), ki = spectrum[(size_t)k].imag();
+
+            realWeights.push_back(kr);
+            realWeights.push_back(ki);
+            imagWeights.push_back(-ki);
+            imagWeights.push_back(kr);
+        }
+    }
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Attack/release envelope followers with peak hold and decay for a whole set of features at once.
+// State is kept as one array per quantity rather than one object per follower, so an update is a
+// single branch free pass the compiler can vectorise however many bands there are.
+// Coefficients come from time constants and the time since the last update, so the response
+// is the same whatever the FFT size, overlap or sample rate.
+class EnvelopeFollowerBank
+{
+public:
+    // All in seconds, a hold of zero turns peak hold off and the peaks just track the envelopes
+    struct Times
+    {
+        float attack = 0.01f, release = 0.15f;
+        float hold = 0.1f, peakDecay = 0.5f;
+    };
+
+    explicit EnvelopeFollowerBank(int maxFollowers)
+        : envelopes((size_t)maxFollowers), peaks((size_t)maxFollowers), holdRemaining((size_t)maxFollowers)
+    {
+    }
+
+    // Not thread safe, call from the thread that calls process
+    void setTimes(const Times &newTimes) noexcept { times = newTimes; }
+    const Times &getTimes() const noexcept { return times; }
+
+    // Call when the inputs stop meaning the same thing, the next update starts from its input
+    void reset() noexcept { primed = false; }
+
+    // Moves the first num followers towards input, interval is the time since the previous call
+    void process(const float *input, int num, float interval) noexcept
+    {
+        jassert(num <= (int)envelopes.size());
+
+        auto *y = envelopes.data();
+        auto *p = peaks.data();
+        auto *h = holdRemaining.data();
+
+        if (!primed)
+        {
+            std::copy_n(input, num, y);
+            std::copy_n(input, num, p);
+            std::fill_n(h, num, times.hold);
+            primed = true;
+            return;
+        }
+
+        auto attack = getCoefficient(times.attack, interval);
+        auto release = getCoefficient(times.release, interval);
+
+        // picking the coefficient is a select rather than a branch, so the loop still vectorises
+        for (int i = 0; i < num; ++i)
+        {
+            auto x = input[i];
+            auto coefficient = x > y[i] ? attack : release;
+            y[i] = x + coefficient * (y[i] - x);
+        }
+
+        if (times.hold <= 0.0f)
+        {
+            std::copy_n(y, num, p);
+            return;
+        }
+
+        auto decay = getCoefficient(times.peakDecay, interval);
+        auto hold = times.hold;
+
+        // a new peak restarts the hold, once it runs out the peak decays towards the envelope
+        for (int i = 0; i < num; ++i)
+        {
+            auto isNewPeak = y[i] >= p[i];
+            h[i] = isNewPeak ? hold : h[i] - interval;
+            auto held = h[i] > 0.0f ? p[i] : p[i] * decay;
+            p[i] = juce::jmax(y[i], held);
+        }
+    }
+
+    const float *getEnvelopes() const noexcept { return envelopes.data(); }
+    const float *getPeaks() const noexcept { return peaks.data(); }
+
+private:
+    std::vector<float> envelopes, peaks, holdRemaining;
+    Times times;
+    bool primed = false;
+
+    // one pole coefficient that covers 1 - 1/e of the distance in timeConstant
+    static float getCoefficient(float timeConstant, float interval) noexcept
+    {
+        return timeConstant > 0.0f ? std::exp(-interval / timeConstant) : 0.0f;
+    }
+};
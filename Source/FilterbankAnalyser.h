@@ -0,0 +1,128 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "BandAnalyser.h"
+
+// Time domain bands from a bank of band-pass biquads followed by RMS and peak detectors.
+// There's no analysis window to fill, so a band reacts as soon as its filter does instead of half
+// an FFT frame later, at the cost of the FFT's resolution. Bands come from a BandAnalyser layout
+// and are processed SIMDRegister::size() at a time, each lane one band of the same input sample.
+class FilterbankAnalyser
+{
+public:
+    using Band = BandAnalyser::Band;
+    using Vector = juce::dsp::SIMDRegister<float>;
+
+    explicit FilterbankAnalyser(int maxChannels) : numChannels(maxChannels), numSamplesSeen((size_t)maxChannels) {}
+
+    // Designs one RBJ constant peak gain band-pass per band of layout, which only needs its frequencies
+    void prepare(double sampleRate, const BandAnalyser &layout)
+    {
+        numBands = layout.getNumBands();
+        numGroups = (numBands + (int)Vector::size() - 1) / (int)Vector::size();
+
+        bands.clear();
+        b0.assign((size_t)numGroups, Vector::expand(0.0f));
+        b2 = a1 = a2 = b0;
+
+        for (int i = 0; i < numBands; ++i)
+        {
+            auto &band = layout.getBand(i);
+            bands.push_back(band);
+
+            auto w0 = juce::MathConstants<double>::twoPi * band.centreFrequency / sampleRate;
+            auto q = band.centreFrequency / (band.highFrequency - band.lowFrequency);
+            auto alpha = std::sin(w0) / (2.0 * q);
+            auto a0 = 1.0 + alpha;
+
+            auto group = (size_t)i / Vector::size(), lane = (size_t)i % Vector::size();
+            b0[group].set(lane, (float)(alpha / a0));
+            b2[group].set(lane, (float)(-alpha / a0));
+            a1[group].set(lane, (float)(-2.0 * std::cos(w0) / a0));
+            a2[group].set(lane, (float)((1.0 - alpha) / a0));
+        }
+
+        auto stateSize = (size_t)(numChannels * numGroups);
+        z1.resize(stateSize);
+        z2.resize(stateSize);
+        sumSquares.resize(stateSize);
+        peaks.resize(stateSize);
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        std::fill(z1.begin(), z1.end(), Vector::expand(0.0f));
+        std::fill(z2.begin(), z2.end(), Vector::expand(0.0f));
+        std::fill(sumSquares.begin(), sumSquares.end(), Vector::expand(0.0f));
+        std::fill(peaks.begin(), peaks.end(), Vector::expand(0.0f));
+        std::fill(numSamplesSeen.begin(), numSamplesSeen.end(), 0);
+    }
+
+    int getNumBands() const noexcept { return numBands; }
+    const Band &getBand(int index) const noexcept { return bands[(size_t)index]; }
+
+    // Runs samples of one channel through every band, can be called several times between getLevels
+    void process(int channel, const float *samples, int numSamples) noexcept
+    {
+        auto offset = (size_t)(channel * numGroups);
+
+        // each group keeps its state in registers for the whole run of samples
+        for (size_t g = 0; g < (size_t)numGroups; ++g)
+        {
+            auto s1 = z1[offset + g], s2 = z2[offset + g];
+            auto energy = sumSquares[offset + g], peak = peaks[offset + g];
+            auto c0 = b0[g], c2 = b2[g], d1 = a1[g], d2 = a2[g];
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto x = Vector::expand(samples[i]);
+                auto y = c0 * x + s1;
+                s1 = s2 - d1 * y;
+                s2 = c2 * x - d2 * y;
+
+                energy += y * y;
+                peak = Vector::max(peak, Vector::abs(y));
+            }
+
+            z1[offset + g] = s1;
+            z2[offset + g] = s2;
+            sumSquares[offset + g] = energy;
+            peaks[offset + g] = peak;
+        }
+
+        numSamplesSeen[(size_t)channel] += numSamples;
+    }
+
+    // Writes each band's amplitude over the samples since the last call, from its RMS scaled so
+    // a sine reads its peak, and its actual peak. Then starts the next measurement.
+    void getLevels(int channel, float *amplitudes, float *bandPeaks) noexcept
+    {
+        auto offset = (size_t)(channel * numGroups);
+        auto count = juce::jmax(1, numSamplesSeen[(size_t)channel]);
+        auto scale = 2.0f / (float)count;
+
+        for (int i = 0; i < numBands; ++i)
+        {
+            auto group = offset + (size_t)i / Vector::size(), lane = (size_t)i % Vector::size();
+            amplitudes[i] = std::sqrt(scale * sumSquares[group].get(lane));
+            bandPeaks[i] = peaks[group].get(lane);
+        }
+
+        std::fill_n(sumSquares.begin() + (std::ptrdiff_t)offset, numGroups, Vector::expand(0.0f));
+        std::fill_n(peaks.begin() + (std::ptrdiff_t)offset, numGroups, Vector::expand(0.0f));
+        numSamplesSeen[(size_t)channel] = 0;
+    }
+
+private:
+    const int numChannels;
+    int numBands = 0, numGroups = 0;
+    std::vector<Band> bands;
+
+    // Transposed direct form II with b1 = 0, one lane per band
+    std::vector<Vector> b0, b2, a1, a2;
+
+    // one run of numGroups per channel
+    std::vector<Vector> z1, z2, sumSquares, peaks;
+    std::vector<int> numSamplesSeen;
+};
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_MAC || JUCE_IOS
+#include <dispatch/dispatch.h>
+#elif JUCE_WINDOWS
+#include <windows.h>
+#else
+#include <cerrno>
+#include <semaphore.h>
+#endif
+
+// Lock-free data structures shared between the audio, analysis and render threads
+
+static constexpr size_t cacheLineSize = 64;
+
+// Wait-free single producer / single consumer ring buffer.
+// Indices grow monotonically and are masked on access, so full and empty are never ambiguous.
+// Each index lives on its own cache line so the producer and consumer never false-share.
+// Several lanes (e.g. audio channels) can share one pair of indices so they always stay in step.
+template <typename T>
+class SpscRingBuffer
+{
+public:
+    explicit SpscRingBuffer(int minimumCapacity, int lanes = 1)
+        : capacity((size_t)juce::nextPowerOfTwo(minimumCapacity)),
+          mask(capacity - 1),
+          numLanes(lanes),
+          buffer(capacity * (size_t)lanes)
+    {
+        jassert(minimumCapacity > 0 && lanes > 0);
+    }
+
+    // Producer side, copies as much as fits in at most two spans per lane and returns the number written.
+    // Lanes past numLanesToWrite are left untouched.
+    int push(const T *const *src, int numLanesToWrite, int numItems) noexcept
+    {
+        jassert(numLanesToWrite <= numLanes);
+
+        auto write = writeIndex.load(std::memory_order_relaxed);
+        auto numFree = capacity - (write - readIndex.load(std::memory_order_acquire));
+        auto numToWrite = juce::jmin(numFree, (size_t)numItems);
+
+        auto start = write & mask;
+        auto firstSpan = juce::jmin(numToWrite, capacity - start);
+
+        for (int lane = 0; lane < numLanesToWrite; ++lane)
+        {
+            auto *dest = getLane(lane);
+            std::copy_n(src[lane], firstSpan, dest + start);
+            std::copy_n(src[lane] + firstSpan, numToWrite - firstSpan, dest);
+        }
+
+        writeIndex.store(write + numToWrite, std::memory_order_release);
+        return (int)numToWrite;
+    }
+
+    int push(const T *src, int numItems) noexcept
+    {
+        return push(&src, 1, numItems);
+    }
+
+    // Consumer side, hands the oldest numItems ready items of a lane to fn(const T *data, int offset, int count)
+    // as at most two contiguous spans without consuming them. Returns false if fewer are ready.
+    template <typename SpanFn>
+    bool peek(int lane, int numItems, SpanFn &&fn) const
+    {
+        auto read = readIndex.load(std::memory_order_relaxed);
+
+        if (writeIndex.load(std::memory_order_acquire) - read < (size_t)numItems)
+            return false;
+
+        auto *src = getLane(lane);
+        auto start = read & mask;
+        auto firstSpan = (int)juce::jmin((size_t)numItems, capacity - start);
+
+        fn(src + start, 0, firstSpan);
+
+        if (firstSpan < numItems)
+            fn(src, firstSpan, numItems - firstSpan);
+
+        return true;
+    }
+
+    template <typename SpanFn>
+    bool peek(int numItems, SpanFn &&fn) const
+    {
+        return peek(0, numItems, fn);
+    }
+
+    // Consumer side, releases items already read with peek
+    void discard(int numItems) noexcept
+    {
+        auto read = readIndex.load(std::memory_order_relaxed);
+        jassert((size_t)numItems <= writeIndex.load(std::memory_order_acquire) - read);
+        readIndex.store(read + (size_t)numItems, std::memory_order_release);
+    }
+
+    // Consumer side, returns the number of items of the first lane copied into dest
+    int pop(T *dest, int maxItems) noexcept
+    {
+        auto numToRead = juce::jmin(getNumReady(), maxItems);
+
+        peek(numToRead, [dest](const T *src, int offset, int count)
+             { std::copy_n(src, count, dest + offset); });
+
+        discard(numToRead);
+        return numToRead;
+    }
+
+    int getNumReady() const noexcept
+    {
+        return (int)(writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire));
+    }
+
+    int getCapacity() const noexcept { return (int)capacity; }
+    int getNumLanes() const noexcept { return numLanes; }
+
+private:
+    const size_t capacity, mask;
+    const int numLanes;
+    std::vector<T> buffer;
+
+    alignas(cacheLineSize) std::atomic<size_t> writeIndex{0};
+    alignas(cacheLineSize) std::atomic<size_t> readIndex{0};
+
+    T *getLane(int lane) noexcept { return buffer.data() + (size_t)lane * capacity; }
+    const T *getLane(int lane) const noexcept { return buffer.data() + (size_t)lane * capacity; }
+
+    JUCE_DECLARE_NON_COPYABLE(SpscRingBuffer)
+};
+
+// Lock-free triple buffer for handing the latest value of something from one thread to another.
+// The writer and reader each own a buffer and swap it with the shared middle one, so neither ever
+// waits and the reader always sees a complete value. Intermediate values are skipped, not queued.
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Writer side, fill in the buffer and then publish it
+    T &getWriteBuffer() noexcept { return buffers[(size_t)writeIndex]; }
+
+    void publish() noexcept
+    {
+        writeIndex = middle.exchange(writeIndex | newDataBit, std::memory_order_acq_rel) & indexMask;
+    }
+
+    void write(const T &value)
+    {
+        getWriteBuffer() = value;
+        publish();
+    }
+
+    // Reader side, picks up the most recently published value and returns true if it's new
+    bool update() noexcept
+    {
+        if ((middle.load(std::memory_order_relaxed) & newDataBit) == 0)
+            return false;
+
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    const T &getReadBuffer() const noexcept { return buffers[(size_t)readIndex]; }
+
+private:
+    static constexpr int indexMask = 3, newDataBit = 4;
+
+    std::array<T, 3> buffers{};
+
+    alignas(cacheLineSize) std::atomic<int> middle{1};
+    alignas(cacheLineSize) int writeIndex = 0;
+    alignas(cacheLineSize) int readIndex = 2;
+};
+
+// Counting semaphore for waking a thread from the audio thread. juce::WaitableEvent locks a mutex
+// inside signal(), these only touch an atomic unless a thread is actually asleep on them, so post
+// never blocks. wait sleeps until a post arrives, with no timeout.
+class WakeUpSemaphore
+{
+public:
+    WakeUpSemaphore()
+    {
+#if JUCE_MAC || JUCE_IOS
+        semaphore = dispatch_semaphore_create(0);
+#elif JUCE_WINDOWS
+        semaphore = CreateSemaphoreW(nullptr, 0, LONG_MAX, nullptr);
+#else
+        sem_init(&semaphore, 0, 0);
+#endif
+    }
+
+    ~WakeUpSemaphore()
+    {
+#if JUCE_MAC || JUCE_IOS
+        dispatch_release(semaphore);
+#elif JUCE_WINDOWS
+        CloseHandle(semaphore);
+#else
+        sem_destroy(&semaphore);
+#endif
+    }
+
+    void post() noexcept
+    {
+#if JUCE_MAC || JUCE_IOS
+        dispatch_semaphore_signal(semaphore);
+#elif JUCE_WINDOWS
+        ReleaseSemaphore(semaphore, 1, nullptr);
+#else
+        sem_post(&semaphore);
+#endif
+    }
+
+    void wait() noexcept
+    {
+#if JUCE_MAC || JUCE_IOS
+        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+#elif JUCE_WINDOWS
+        WaitForSingleObject(semaphore, INFINITE);
+#else
+        while (sem_wait(&semaphore) != 0 && errno == EINTR)
+        {
+        }
+#endif
+    }
+
+private:
+#if JUCE_MAC || JUCE_IOS
+    dispatch_semaphore_t semaphore;
+#elif JUCE_WINDOWS
+    HANDLE semaphore;
+#else
+    sem_t semaphore;
+#endif
+
+    JUCE_DECLARE_NON_COPYABLE(WakeUpSemaphore)
+};
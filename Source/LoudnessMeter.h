@@ -0,0 +1,241 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "VectorOps.h"
+
+// ITU-R BS.1770 loudness and true peak of the captured signal, run on every block as it arrives.
+// Each channel goes through the two K-weighting biquads and its squares are summed into 10 ms
+// slices. Momentary (400 ms) and short-term (3 s) loudness are running sums over a ring of slices,
+// so a slice costs O(1) however long the windows are. True peak comes from 4x polyphase upsampling.
+class LoudnessMeter
+{
+public:
+    struct Result
+    {
+        float momentary = silence, shortTerm = silence; // LUFS, silence when below the absolute gate
+        float truePeak = silence;                       // dBTP over the last 400 ms
+        float maxTruePeak = silence;                    // dBTP since prepare
+    };
+
+    static constexpr float absoluteGate = -70.0f, silence = -100.0f;
+
+    explicit LoudnessMeter(int maxChannels) : channels((size_t)maxChannels)
+    {
+        makeTruePeakFilter();
+    }
+
+    // Audio thread before playback starts, nothing is allocated
+    void prepare(double sampleRate)
+    {
+        sliceLength = juce::jmax(1, juce::roundToInt(sampleRate / slicesPerSecond));
+        makeKWeighting(sampleRate);
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        for (auto &channel : channels)
+            channel = {};
+
+        sliceEnergies.fill(0.0);
+        slicePeaks.fill(0.0f);
+        sliceIndex = sliceSamples = 0;
+        sliceEnergy = momentarySum = shortTermSum = 0.0;
+        slicePeak = 0.0f;
+        result = {};
+    }
+
+    void process(const float *const *inputs, int numInputs, int numSamples) noexcept
+    {
+        numInputs = juce::jmin(numInputs, (int)channels.size());
+
+        // run each channel up to the next slice boundary, so the filter state stays in registers
+        for (int done = 0; done < numSamples;)
+        {
+            auto count = juce::jmin(numSamples - done, sliceLength - sliceSamples);
+
+            for (int channel = 0; channel < numInputs; ++channel)
+            {
+                auto gain = getChannelGain(channel, numInputs);
+
+                if (gain > 0.0)
+                    sliceEnergy += gain * processChannel(channels[(size_t)channel], inputs[channel] + done, count);
+            }
+
+            sliceSamples += count;
+            done += count;
+
+            if (sliceSamples == sliceLength)
+                closeSlice();
+        }
+    }
+
+    const Result &getResult() const noexcept { return result; }
+
+private:
+    static constexpr int slicesPerSecond = 100;
+    static constexpr int momentarySlices = 40, shortTermSlices = 300;
+    static constexpr int truePeakFactor = 4, tapsPerPhase = 12;
+
+    struct Biquad
+    {
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+    };
+
+    struct ChannelState
+    {
+        double z1 = 0.0, z2 = 0.0, z3 = 0.0, z4 = 0.0; // transposed direct form II, both stages
+
+        // each sample is written twice so the newest tapsPerPhase are always contiguous
+        std::array<float, tapsPerPhase * 2> history{};
+        int historyIndex = 0;
+    };
+
+    std::vector<ChannelState> channels;
+    Biquad shelf, highPass;
+    std::array<std::array<float, tapsPerPhase>, truePeakFactor> truePeakPhases{};
+
+    int sliceLength = 441;
+    std::array<double, shortTermSlices> sliceEnergies{};
+    std::array<float, shortTermSlices> slicePeaks{};
+    int sliceIndex = 0, sliceSamples = 0;
+    double sliceEnergy = 0.0, momentarySum = 0.0, shortTermSum = 0.0;
+    float slicePeak = 0.0f;
+    Result result;
+
+    // Returns the sum of the K-weighted squares and folds the inter-sample peak into slicePeak
+    double processChannel(ChannelState &state, const float *input, int numSamples) noexcept
+    {
+        auto z1 = state.z1, z2 = state.z2, z3 = state.z3, z4 = state.z4;
+        double energy = 0.0;
+        auto peak = slicePeak;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto x = (double)input[i];
+
+            auto s = shelf.b0 * x + z1;
+            z1 = shelf.b1 * x - shelf.a1 * s + z2;
+            z2 = shelf.b2 * x - shelf.a2 * s;
+
+            auto y = highPass.b0 * s + z3;
+            z3 = highPass.b1 * s - highPass.a1 * y + z4;
+            z4 = highPass.b2 * s - highPass.a2 * y;
+
+            energy += y * y;
+
+            state.history[(size_t)state.historyIndex] = state.history[(size_t)(state.historyIndex + tapsPerPhase)] = input[i];
+            state.historyIndex = (state.historyIndex + 1) % tapsPerPhase;
+
+            for (auto &phase : truePeakPhases)
+                peak = juce::jmax(peak, std::abs(VectorOps::dotProduct(state.history.data() + state.historyIndex, phase.data(), tapsPerPhase)));
+        }
+
+        state.z1 = z1;
+        state.z2 = z2;
+        state.z3 = z3;
+        state.z4 = z4;
+        slicePeak = peak;
+        return energy;
+    }
+
+    void closeSlice() noexcept
+    {
+        auto momentaryOldest = (sliceIndex - momentarySlices + shortTermSlices) % shortTermSlices;
+
+        momentarySum += sliceEnergy - sliceEnergies[(size_t)momentaryOldest];
+        shortTermSum += sliceEnergy - sliceEnergies[(size_t)sliceIndex];
+        sliceEnergies[(size_t)sliceIndex] = sliceEnergy;
+        slicePeaks[(size_t)sliceIndex] = slicePeak;
+
+        sliceIndex = (sliceIndex + 1) % shortTermSlices;
+        sliceEnergy = 0.0;
+        slicePeak = 0.0f;
+        sliceSamples = 0;
+
+        // sum afresh once per lap so rounding in the running sums can't build up
+        if (sliceIndex == 0)
+        {
+            shortTermSum = momentarySum = 0.0;
+
+            for (int i = 0; i < shortTermSlices; ++i)
+                shortTermSum += sliceEnergies[(size_t)i];
+
+            for (int i = shortTermSlices - momentarySlices; i < shortTermSlices; ++i)
+                momentarySum += sliceEnergies[(size_t)i];
+        }
+
+        result.momentary = toLoudness(momentarySum, momentarySlices);
+        result.shortTerm = toLoudness(shortTermSum, shortTermSlices);
+
+        auto peak = 0.0f;
+
+        for (int i = 1; i <= momentarySlices; ++i)
+            peak = juce::jmax(peak, slicePeaks[(size_t)((sliceIndex - i + shortTermSlices) % shortTermSlices)]);
+
+        result.truePeak = juce::Decibels::gainToDecibels(peak, silence);
+        result.maxTruePeak = juce::jmax(result.maxTruePeak, result.truePeak);
+    }
+
+    float toLoudness(double sum, int numSlices) const noexcept
+    {
+        auto meanSquare = juce::jmax(0.0, sum) / ((double)numSlices * sliceLength);
+        auto loudness = meanSquare > 0.0 ? (float)(-0.691 + 10.0 * std::log10(meanSquare)) : silence;
+
+        return loudness < absoluteGate ? silence : loudness;
+    }
+
+    // BS.1770 channel weights, surrounds count 1.41 and the LFE not at all in a 5.1 layout
+    static double getChannelGain(int channel, int numChannels) noexcept
+    {
+        if (numChannels != 6)
+            return 1.0;
+
+        return channel == 3 ? 0.0 : channel >= 4 ? 1.41 : 1.0;
+    }
+
+    // The BS.1770 pre-filter and RLB high-pass, from their analogue prototypes so any sample rate works
+    void makeKWeighting(double sampleRate)
+    {
+        {
+            auto k = std::tan(juce::MathConstants<double>::pi * 1681.974450955533 / sampleRate);
+            auto q = 0.7071752369554196;
+            auto vh = std::pow(10.0, 3.999843853973347 / 20.0);
+            auto vb = std::pow(vh, 0.4996667741545416);
+            auto a0 = 1.0 + k / q + k * k;
+
+            shelf = {(vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+                     2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+        }
+
+        {
+            auto k = std::tan(juce::MathConstants<double>::pi * 38.13547087602444 / sampleRate);
+            auto q = 0.5003270373238773;
+            auto a0 = 1.0 + k / q + k * k;
+
+            highPass = {1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+        }
+    }
+
+    // Hann windowed sinc low-pass at the original Nyquist, split into one short filter per phase
+    void makeTruePeakFilter()
+    {
+        constexpr auto numTaps = truePeakFactor * tapsPerPhase;
+        constexpr auto centre = numTaps / 2; // on a tap, so the phases land on 0, 1/4, 1/2 and 3/4 of a sample
+        std::array<float, numTaps> taps{}; // phase p, tap k at k * truePeakFactor + p
+
+        for (int n = 0; n < numTaps; ++n)
+        {
+            auto t = (double)(n - centre) / truePeakFactor;
+            auto sinc = std::abs(t) < 1.0e-9 ? 1.0 : std::sin(juce::MathConstants<double>::pi * t) / (juce::MathConstants<double>::pi * t);
+            auto window = 0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * (n + 0.5) / numTaps);
+
+            taps[(size_t)n] = (float)(sinc * window);
+        }
+
+        // history runs oldest to newest, so each phase's taps go in reverse
+        for (int p = 0; p < truePeakFactor; ++p)
+            for (int k = 0; k < tapsPerPhase; ++k)
+                truePeakPhases[(size_t)p][(size_t)(tapsPerPhase - 1 - k)] = taps[(size_t)(k * truePeakFactor + p)];
+    }
+};
@@ -1,6 +1,6 @@
 #include "MainComponent.h"
 
-MainComponent::MainComponent() : audioSettingsComponent(audioDeviceManager), forwardFFT(fftOrder)
+MainComponent::MainComponent() : audioSettingsComponent(audioDeviceManager), analyser(*this)
 {
     if (auto *peer = getPeer())
         peer->setCurrentRenderingEngine(0);
@@ -12,6 +12,7 @@ MainComponent::MainComponent() : audioSettingsComponent(audioDeviceManager), for
     setShaderProgram(shaderPreset.vertexShader, shaderPreset.fragmentShader);
     setTexture(new TextureFromAsset("port.jpg"));
 
+    openGLContext.setOpenGLVersionRequired(OpenGLContext::openGL3_2); // the presets share a uniform block
     openGLContext.setRenderer(this);
     openGLContext.attachTo(*this);
     openGLContext.setContinuousRepainting(true);
@@ -23,7 +24,6 @@ MainComponent::MainComponent() : audioSettingsComponent(audioDeviceManager), for
                                           int numInputChannels = granted ? 2 : 0;
                                           setAudioChannels(numInputChannels, 0);
                                       });
-    startTimerHz(60);
 
     // setup display
     addChildComponent(audioSettingsComponent);
@@ -36,6 +36,7 @@ MainComponent::~MainComponent()
 {
     openGLContext.detach();
     shutDownAudio();
+    analyser.stop();
     removeKeyListener(this);
 }
 
@@ -48,28 +49,12 @@ void MainComponent::resized()
     // This is called when the MainComponent is resized.
     // If you add any child components, this is where you should
     // update their positions.
-    const ScopedLock lock(mutex);
-    bounds = getLocalBounds();
+    viewSnapshot.write({getLocalBounds()});
 }
 
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo &bufferToFill)
 {
-    if (bufferToFill.buffer->getNumChannels() > 0)
-    {
-        auto *channelData = bufferToFill.buffer->getReadPointer(0, bufferToFill.startSample);
-
-        for (auto i = 0; i < bufferToFill.numSamples; ++i)
-            pushNextSampleIntoFifo(channelData[i]);
-    }
-}
-
-void MainComponent::timerCallback()
-{
-    if (nextFFTBlockReady)
-    {
-        processFFT();
-        nextFFTBlockReady = false;
-    }
+    analyser.pushBlock(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
 }
 
 bool MainComponent::keyPressed(const KeyPress &key, Component *source)
@@ -90,60 +75,65 @@ bool MainComponent::keyPressed(const KeyPress &key, Component *source)
     return false;
 }
 
-// Public DSP
-void MainComponent::pushNextSampleIntoFifo(float sample)
-{
-    // if the fifo contains enough data, set a flag to say
-    // that the next line should now be rendered..
-    if (fifoIndex == fftSize)
-    {
-        if (!nextFFTBlockReady)
-        {
-            std::fill(fftData.begin(), fftData.end(), 0.0f);
-            std::copy(fifo.begin(), fifo.end(), fftData.begin());
-            nextFFTBlockReady = true;
-        }
-
-        fifoIndex = 0;
-    }
-
-    fifo[(size_t)fifoIndex++] = sample;
-}
-
-void MainComponent::processFFT()
-{
-    juce::ScopedLock lock(mutex);
-    forwardFFT.performFrequencyOnlyForwardTransform(fftData.data());
-
-    auto maxLevel = juce::FloatVectorOperations::findMinAndMax(fftData.data(), 256);
-    float normalized_peak = juce::mapFromLog10(juce::jmax(maxLevel.getEnd(), 1e-5f), 1e-5f, 1e+2f);
-
-    sensitivity = normalized_peak;
-}
-
 // Public Audio
 void MainComponent::prepareToPlay(int samplesPerBlockExpected, double newSampleRate)
 {
+    analyser.prepare(newSampleRate, samplesPerBlockExpected);
 }
 
 void MainComponent::releaseResources()
 {
+    analyser.stop();
 }
 
 // Public Graphics
 void MainComponent::newOpenGLContextCreated()
 {
+    using namespace ::juce::gl;
+
     freeAllContextObjects();
+
+    // a driver can still hand back an older context than the one asked for
+    contextIsRecentEnough = isContextRecentEnough();
+
+    // JUCE binds a vertex array of its own for the 2D renderer, Shape::draw leaves its own bound
+    if (contextIsRecentEnough)
+    {
+        GLint vertexArray = 0;
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vertexArray);
+        juceVertexArray = (GLuint)vertexArray;
+    }
+    else
+    {
+        const ScopedLock lock(shaderMutex);
+        statusText = "Needs OpenGL 3.2 or OpenGL ES 3.0";
+        triggerAsyncUpdate();
+    }
 }
 
 void MainComponent::renderOpenGL()
 {
     using namespace ::juce::gl;
 
-    const ScopedLock lock(mutex);
-
     jassert(OpenGLHelpers::isContextActive());
 
+    if (!contextIsRecentEnough)
+    {
+        OpenGLHelpers::clear(Colour(0xff000000));
+        return;
+    }
+
+    if (spectrumTexture == nullptr)
+        spectrumTexture.reset(new SpectrumTexture(numSpectrumPoints));
+
+    if (spectrogramTexture == nullptr)
+        spectrogramTexture.reset(new SpectrogramTexture(numSpectrumPoints, spectrogramHistory));
+
+    if (frameUniforms == nullptr)
+        frameUniforms.reset(new FrameUniformBuffer());
+
+    updateFromSnapshots();
+
     auto desktopScale = (float)openGLContext.getRenderingScale();
 
     OpenGLHelpers::clear(Colour(0xff000000));
@@ -180,26 +170,42 @@ void MainComponent::renderOpenGL()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-    shader->use();
+    // the spectrum and spectrogram live on units 1 and 2 so they never displace the demo texture
+    glActiveTexture(GL_TEXTURE1);
+    spectrumTexture->bind();
+    glActiveTexture(GL_TEXTURE2);
+    spectrogramTexture->bind();
+    glActiveTexture(GL_TEXTURE0);
+
+    // every preset reads these from FRAME_UNIFORMS_BLOCK, so one write serves whichever program is in use
+    FrameUniformBlock frameBlock{};
+    std::copy_n(getProjectionMatrix().mat, 16, frameBlock.projectionMatrix);
+    std::copy_n(getViewMatrix().mat, 16, frameBlock.viewMatrix);
+    frameBlock.lightPosition[0] = -15.0f;
+    frameBlock.lightPosition[1] = 10.0f;
+    frameBlock.lightPosition[2] = 15.0f;
+    frameBlock.bouncingNumber = bouncingNumber.getValue();
+    frameBlock.spectrogramHead = spectrogramTexture->getHead();
 
-    if (uniforms->projectionMatrix != nullptr)
-        uniforms->projectionMatrix->setMatrix4(getProjectionMatrix().mat, 1, false);
+    frameUniforms->write(frameBlock);
 
-    if (uniforms->viewMatrix != nullptr)
-        uniforms->viewMatrix->setMatrix4(getViewMatrix().mat, 1, false);
+    shader->use();
 
     if (uniforms->texture != nullptr)
         uniforms->texture->set((GLint)0);
 
-    if (uniforms->lightPosition != nullptr)
-        uniforms->lightPosition->set(-15.0f, 10.0f, 15.0f, 0.0f);
+    if (uniforms->spectrumTexture != nullptr)
+        uniforms->spectrumTexture->set((GLint)1);
 
-    if (uniforms->bouncingNumber != nullptr)
-        uniforms->bouncingNumber->set(bouncingNumber.getValue());
+    if (uniforms->spectrogramTexture != nullptr)
+        uniforms->spectrogramTexture->set((GLint)2);
 
     shape->draw(*attributes);
+    frameUniforms->endFrame();
 
-    // Reset the element buffers so child Components draw correctly
+    // Reset the element buffers so child Components draw correctly, once JUCE's vertex array is
+    // back, or the element buffer unbinding would land in the shape's
+    glBindVertexArray(juceVertexArray);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
@@ -218,8 +224,6 @@ void MainComponent::openGLContextClosing()
 
 Matrix3D<float> MainComponent::getProjectionMatrix() const
 {
-    const ScopedLock lock(mutex);
-
     auto w = 0.35f;
     auto h = w * bounds.toFloat().getAspectRatio(false);
 
@@ -228,7 +232,6 @@ Matrix3D<float> MainComponent::getProjectionMatrix() const
 
 Matrix3D<float> MainComponent::getViewMatrix() const
 {
-    const ScopedLock lock(mutex);
     float PI = MathConstants<float>::twoPi;
     auto axis = Vector3D<float>(0.5f, 0.5f, 0.5f);
     // if we had controls
@@ -266,6 +269,9 @@ void MainComponent::freeAllContextObjects()
     shader.reset();
     attributes.reset();
     uniforms.reset();
+    spectrumTexture.reset();
+    spectrogramTexture.reset();
+    frameUniforms.reset();
     texture.release();
 }
 
@@ -284,7 +290,88 @@ void MainComponent::shutDownAudio()
     audioDeviceManager.removeAudioCallback(&audioSourcePlayer);
 }
 
+// Private DSP
+void MainComponent::analysisFrameReady(const AnalysisFrame &frame)
+{
+    // analysis thread, never waits on the renderer, which reads the frame itself with updateLatestFrame
+
+    // Rows only go in whole. Only the renderer can free space, so rows that find the ring full are
+    // counted, and the count goes in as a marker row ahead of the next row that fits. The gap then
+    // sits in the history where it happened. Spectra are never negative, a marker's first value is.
+    auto numFreeRows = (spectrogramRows.getCapacity() - spectrogramRows.getNumReady()) / numSpectrumPoints;
+
+    if (spectrogramRowsDropped > 0 && numFreeRows > 0)
+    {
+        std::array<float, numSpectrumPoints> marker{};
+        marker[0] = -(float)spectrogramRowsDropped;
+        spectrogramRows.push(marker.data(), numSpectrumPoints);
+        spectrogramRowsDropped = 0;
+        --numFreeRows;
+    }
+
+    if (numFreeRows > 0)
+        spectrogramRows.push(frame.spectrum.data(), numSpectrumPoints);
+    else
+        ++spectrogramRowsDropped;
+}
+
 // Private Graphics
+void MainComponent::updateFromSnapshots()
+{
+    if (viewSnapshot.update())
+        bounds = viewSnapshot.getReadBuffer().bounds;
+
+    // However many frames arrived since the last render go up in one batch. Gap markers from
+    // analysisFrameReady stand for that many silent rows, and only the newest spectrogramHistory
+    // rows of the lot can still be seen, so the oldest are dropped first.
+    auto getNumRowsShown = [](float firstValue)
+    { return firstValue < 0.0f ? juce::jmin((int)-firstValue, spectrogramHistory) : 1; };
+
+    auto numWaiting = spectrogramRows.getNumReady() / numSpectrumPoints;
+    int numRowsShown = 0;
+
+    spectrogramRows.peek(numWaiting * numSpectrumPoints, [&](const float *data, int offset, int count)
+                         {
+                             for (auto i = (numSpectrumPoints - offset % numSpectrumPoints) % numSpectrumPoints; i < count; i += numSpectrumPoints)
+                                 numRowsShown += getNumRowsShown(data[i]);
+                         });
+
+    auto numRowsToSkip = juce::jmax(0, numRowsShown - spectrogramHistory);
+    int numPendingRows = 0;
+
+    for (int row = 0; row < numWaiting; ++row)
+    {
+        spectrogramRows.pop(spectrogramRow.data(), numSpectrumPoints);
+
+        auto numRows = getNumRowsShown(spectrogramRow[0]);
+        auto numSkipped = juce::jmin(numRows, numRowsToSkip);
+        numRowsToSkip -= numSkipped;
+        numRows -= numSkipped;
+
+        auto *dest = pendingRows.data() + (size_t)(numPendingRows * numSpectrumPoints);
+
+        if (spectrogramRow[0] < 0.0f)
+            std::fill_n(dest, numRows * numSpectrumPoints, 0.0f);
+        else if (numRows > 0)
+            std::copy(spectrogramRow.begin(), spectrogramRow.end(), dest);
+
+        numPendingRows += numRows;
+    }
+
+    if (numPendingRows > 0)
+        spectrogramTexture->addRows(pendingRows.data(), numPendingRows);
+
+    if (analyser.updateLatestFrame())
+    {
+        auto &frame = analyser.getLatestFrame();
+        sensitivity = frame.smoothedPeakLevel;
+        spectrumTexture->upload(frame.spectrum.data(), numSpectrumPoints);
+
+        if (frame.tempo.confidence > 0.3f)
+            bouncingNumber.syncToBeat(frame.tempo.beatPhase, frame.tempo.bpm);
+    }
+}
+
 void MainComponent::updateShader()
 {
     const ScopedLock lock(shaderMutex); // Prevent concurrent access to shader strings and status
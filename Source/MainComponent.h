@@ -3,8 +3,9 @@
 #include <JuceHeader.h>
 #include "AudioSettingsComponent.h"
 #include "OpenGLDS.h"
+#include "Analyser.h"
 
-class MainComponent : public juce::Component, public juce::KeyListener, public juce::AudioSource, private juce::Timer, private juce::OpenGLRenderer, private juce::AsyncUpdater
+class MainComponent : public juce::Component, public juce::KeyListener, public juce::AudioSource, private Analyser::Listener, private juce::OpenGLRenderer, private juce::AsyncUpdater
 {
 public:
     MainComponent();
@@ -15,12 +16,6 @@ public:
 
     void getNextAudioBlock(const juce::AudioSourceChannelInfo &) override;
 
-    void timerCallback() override;
-
-    void pushNextSampleIntoFifo(float);
-
-    void processFFT();
-
     bool keyPressed(const juce::KeyPress &, juce::Component *) override;
 
     // Need to be implemented
@@ -38,17 +33,9 @@ public:
     void freeAllContextObjects();
 
     float scale = 1.0f, rotationSpeed = 0.01f;
-    juce::CriticalSection mutex;
-    juce::Rectangle<int> bounds;
+    juce::Rectangle<int> bounds; // render thread copy of viewSnapshot
     BouncingNumber bouncingNumber;
 
-    // DSP
-    enum
-    {
-        fftOrder = 10,
-        fftSize = 1 << fftOrder,
-    };
-
 private:
     // Settings
     bool showSettings = false;
@@ -65,11 +52,16 @@ private:
     float rotation = 0.0f;
     float sensitivity = 1.0f;
     juce::OpenGLContext openGLContext;
+    bool contextIsRecentEnough = false; // see isContextRecentEnough, render thread
+    GLuint juceVertexArray = 0;         // bound by JUCE when the context was created, render thread
 
     std::unique_ptr<juce::OpenGLShaderProgram> shader;
     std::unique_ptr<Shape> shape;
     std::unique_ptr<Attributes> attributes;
     std::unique_ptr<Uniforms> uniforms;
+    std::unique_ptr<SpectrumTexture> spectrumTexture;
+    std::unique_ptr<SpectrogramTexture> spectrogramTexture;
+    std::unique_ptr<FrameUniformBuffer> frameUniforms;
 
     juce::OpenGLTexture texture;
     DemoTexture *textureToUse = nullptr;
@@ -82,11 +74,26 @@ private:
     void handleAsyncUpdate() override;
 
     // DSP Stuff
-    juce::dsp::FFT forwardFFT;
-    std::array<float, fftSize> fifo;
-    std::array<float, fftSize * 2> fftData; // fftSize * 2 to account for real and complex components
-    int fifoIndex = 0;
-    bool nextFFTBlockReady = false;
+    Analyser analyser;
+
+    void analysisFrameReady(const AnalysisFrame &) override;
+
+    // Latest state from the message thread, picked up at the start of each render
+    struct ViewState
+    {
+        juce::Rectangle<int> bounds;
+    };
+
+    TripleBuffer<ViewState> viewSnapshot;
+
+    // every frame's spectrum in order, unlike Analyser::getLatestFrame which skips frames
+    static constexpr int spectrogramHistory = 512; // rows, ~6s at 44.1kHz with 512 sample hops
+    SpscRingBuffer<float> spectrogramRows{numSpectrumPoints * spectrogramHistory * 2}; // slack for renders that fall behind
+    int spectrogramRowsDropped = 0;                                                  // analysis thread, the gap not yet marked
+    std::array<float, numSpectrumPoints> spectrogramRow{};                           // render thread scratch
+    std::vector<float> pendingRows = std::vector<float>((size_t)(numSpectrumPoints * spectrogramHistory)); // render thread scratch
+
+    void updateFromSnapshots();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "VectorOps.h"
+#include "STFT.h"
+#include "BandAnalyser.h"
+
+// Fine bass resolution without a huge FFT.
+// A cascade of half-band decimators makes copies of the input at 1/2, 1/4 ... of the sample rate,
+// and a small FFT of each copy supplies one octave of the spectrum, so bin spacing halves with
+// every octave down. The lower levels fill up more slowly and are only transformed once they have
+// moved on by a quarter of a frame, so the cost per frame stays close to that of one small FFT.
+// The octaves are stitched into one spectrum sorted by frequency, and reduced to a BandAnalyser
+// layout's bands from the power of the points that fall in each.
+class MultiRateAnalyser
+{
+public:
+    using Band = BandAnalyser::Band;
+
+    static constexpr int fftOrder = 9, fftSize = 1 << fftOrder;
+    static constexpr int numLevels = 7; // the lowest runs at 1/64 of the sample rate
+
+    // Each level keeps the bins in [firstBin, 2 * firstBin), which are clear of the half-band
+    // filter's aliasing, so the next level down takes over exactly where this one stops.
+    // The top level also keeps everything up to Nyquist and the bottom one down to the first bin.
+    static constexpr int firstBin = fftSize / 5, endBin = 2 * firstBin;
+
+    explicit MultiRateAnalyser(int maxChannels)
+        : numChannels(maxChannels),
+          levels((size_t)(maxChannels * numLevels)),
+          fft(fftOrder),
+          scratch((size_t)fftSize * 2)
+    {
+        makeHalfBandFilter();
+    }
+
+    void prepare(double sampleRate, const BandAnalyser &layout)
+    {
+        frequencies.clear();
+
+        // lowest level first so the stitched spectrum runs up in frequency
+        for (int level = numLevels - 1; level >= 0; --level)
+        {
+            auto binWidth = sampleRate / ((double)fftSize * (1 << level));
+
+            for (int bin = getFirstBin(level); bin < getEndBin(level); ++bin)
+                frequencies.push_back((float)(bin * binWidth));
+        }
+
+        spectra.assign((size_t)numChannels * frequencies.size(), 0.0f);
+
+        bands.clear();
+
+        for (int i = 0; i < layout.getNumBands(); ++i)
+        {
+            auto band = layout.getBand(i);
+            auto first = std::lower_bound(frequencies.begin(), frequencies.end(), band.lowFrequency);
+            auto end = std::lower_bound(first, frequencies.end(), band.highFrequency);
+
+            // narrower than the point spacing, use the nearest point
+            if (first == end)
+            {
+                first = std::lower_bound(frequencies.begin(), frequencies.end(), band.centreFrequency);
+                first = first == frequencies.end() ? first - 1 : first;
+                end = first + 1;
+            }
+
+            band.firstBin = (int)(first - frequencies.begin());
+            band.numBins = (int)(end - first);
+            band.weightOffset = 0;
+            bands.push_back(band);
+        }
+
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        for (auto &level : levels)
+            level = {};
+
+        std::fill(spectra.begin(), spectra.end(), 0.0f);
+    }
+
+    int getNumBands() const noexcept { return (int)bands.size(); }
+    const Band &getBand(int index) const noexcept { return bands[(size_t)index]; }
+
+    // Runs new samples of one channel down the decimation cascade
+    void push(int channel, const float *samples, int numSamples) noexcept
+    {
+        auto *channelLevels = levels.data() + channel * numLevels;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto x = samples[i];
+
+            for (int level = 0; level < numLevels; ++level)
+            {
+                auto &state = channelLevels[level];
+                state.append(x);
+
+                if (level == numLevels - 1 || !state.decimate(x, halfBand.data()))
+                    break;
+            }
+        }
+    }
+
+    // Transforms the levels that have moved on enough and writes getNumBands() band amplitudes
+    void process(int channel, float *bandLevels) noexcept
+    {
+        auto *spectrum = spectra.data() + (size_t)channel * frequencies.size();
+        auto *window = FixedSizeSTFT<fftOrder>::hannWindow.data();
+        auto offset = frequencies.size();
+
+        for (int level = 0; level < numLevels; ++level)
+        {
+            auto &state = levels[(size_t)(channel * numLevels + level)];
+            offset -= (size_t)(getEndBin(level) - getFirstBin(level));
+
+            if (state.samplesSinceTransform < fftSize / 4)
+                continue;
+
+            state.samplesSinceTransform = 0;
+
+            // oldest sample first, straight out of the ring in two spans
+            auto head = (size_t)state.writeIndex;
+            juce::FloatVectorOperations::multiply(scratch.data(), state.ring.data() + head, window, fftSize - (int)head);
+            juce::FloatVectorOperations::multiply(scratch.data() + fftSize - head, state.ring.data(), window + fftSize - head, (int)head);
+            juce::FloatVectorOperations::clear(scratch.data() + fftSize, fftSize);
+
+            fft.performFrequencyOnlyForwardTransform(scratch.data(), true);
+
+            // unity coherent gain window, so a full scale sine reads 1
+            juce::FloatVectorOperations::copyWithMultiply(spectrum + offset, scratch.data() + getFirstBin(level), 2.0f / (float)fftSize,
+                                                           getEndBin(level) - getFirstBin(level));
+        }
+
+        // band power over the Hann window's 1.5 bin noise bandwidth, so a tone reads its amplitude
+        // however many points of the finer octaves land in the band
+        for (size_t i = 0; i < bands.size(); ++i)
+        {
+            auto *points = spectrum + bands[i].firstBin;
+            bandLevels[i] = std::sqrt(VectorOps::dotProduct(points, points, bands[i].numBins) / 1.5f);
+        }
+    }
+
+    // The stitched spectrum, getNumPoints() amplitudes at getFrequencies() in Hz
+    int getNumPoints() const noexcept { return (int)frequencies.size(); }
+    const float *getFrequencies() const noexcept { return frequencies.data(); }
+    const float *getSpectrum(int channel) const noexcept { return spectra.data() + (size_t)channel * frequencies.size(); }
+
+private:
+    static constexpr int numTaps = 63;
+
+    // One rate of the cascade: the last fftSize samples at this rate, and the half-band filter
+    // history that produces the next rate down
+    struct Level
+    {
+        std::array<float, fftSize> ring{};
+        int writeIndex = 0, samplesSinceTransform = 0;
+
+        // each sample is written twice so the newest numTaps are always contiguous
+        std::array<float, numTaps * 2> history{};
+        int historyIndex = 0;
+        bool skipNext = false;
+
+        void append(float x) noexcept
+        {
+            ring[(size_t)writeIndex] = x;
+            writeIndex = (writeIndex + 1) & (fftSize - 1);
+            ++samplesSinceTransform;
+        }
+
+        // Returns true and replaces x with the next sample at half the rate every second call
+        bool decimate(float &x, const float *coefficients) noexcept
+        {
+            history[(size_t)historyIndex] = history[(size_t)(historyIndex + numTaps)] = x;
+            historyIndex = (historyIndex + 1) % numTaps;
+            skipNext = !skipNext;
+
+            if (skipNext)
+                return false;
+
+            x = VectorOps::dotProduct(history.data() + historyIndex, coefficients, numTaps);
+            return true;
+        }
+    };
+
+    const int numChannels;
+    std::vector<Level> levels; // numLevels per channel
+    std::array<float, numTaps> halfBand{};
+
+    juce::dsp::FFT fft;
+    std::vector<float> scratch;
+
+    std::vector<float> frequencies, spectra; // one stitched spectrum per channel
+    std::vector<Band> bands;                 // firstBin and numBins index the stitched spectrum
+
+    static int getFirstBin(int level) noexcept { return level == numLevels - 1 ? 1 : firstBin; }
+    static int getEndBin(int level) noexcept { return level == 0 ? fftSize / 2 + 1 : endBin; }
+
+    // Blackman windowed sinc cut off at a quarter of the input rate, every other tap is zero
+    void makeHalfBandFilter()
+    {
+        constexpr auto centre = (numTaps - 1) / 2;
+        double total = 0.0;
+
+        for (int n = 0; n < numTaps; ++n)
+        {
+            auto t = n - centre;
+            auto sinc = t == 0 ? 0.5 : std::sin(juce::MathConstants<double>::halfPi * t) / (juce::MathConstants<double>::pi * t);
+            auto phase = juce::MathConstants<double>::twoPi * n / (numTaps - 1);
+            auto window = 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+
+            halfBand[(size_t)n] = (float)(sinc * window);
+            total += sinc * window;
+        }
+
+        // unity gain at DC so every level reads the same level for the same tone
+        for (auto &h : halfBand)
+            h = (float)(h / total);
+    }
+};
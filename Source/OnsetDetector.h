@@ -0,0 +1,116 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "VectorOps.h"
+
+// Streaming spectral flux onset detector.
+// Flux is the half-wave rectified rise in magnitude across all bins and channels since the last frame.
+// A frame is an onset when its flux is a local maximum above an adaptive threshold built from the
+// median of recent flux, so sustained energy raises the bar and only sudden rises get through.
+// Everything is sized up front, a frame costs O(bins) time and no allocation.
+class OnsetDetector
+{
+public:
+    struct Result
+    {
+        float flux = 0.0f, threshold = 0.0f;
+        bool isOnset = false;
+        juce::int64 onsetSample = 0; // stream position of the onset, interpolated between hops
+        float strength = 0.0f;       // how far the flux peak cleared the threshold
+    };
+
+    OnsetDetector(int maxChannels, int maxBins)
+        : binsPerChannel(maxBins), previousMagnitudes((size_t)(maxChannels * maxBins)), difference((size_t)maxBins)
+    {
+    }
+
+    // Call when the bins stop meaning the same thing, e.g. the FFT size or channel layout changed
+    void reset()
+    {
+        std::fill(previousMagnitudes.begin(), previousMagnitudes.end(), 0.0f);
+        fluxHistory.fill(0.0f);
+        historyIndex = 0;
+        numFramesSeen = 0;
+        olderFlux = previousFlux = previousThreshold = 0.0f;
+        lastOnsetSample = std::numeric_limits<juce::int64>::min() / 2;
+    }
+
+    float thresholdMultiplier = 1.5f;  // how far above the running median a peak has to be
+    float minimumFlux = 1.0e-3f;       // floor so noise in silence can't trigger
+    double minimumIntervalSeconds = 0.05;
+
+    // rows holds numChannels magnitude spectra rowStride apart, frameCentre is the stream position
+    // of the middle of this frame.
+    Result process(const float *rows, size_t rowStride, int numChannels, int numBins, int fftSize,
+                   juce::int64 frameCentre, int hopSize, double sampleRate) noexcept
+    {
+        jassert(numBins <= binsPerChannel);
+
+        float flux = 0.0f;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto *current = rows + (size_t)channel * rowStride;
+            auto *previous = previousMagnitudes.data() + (size_t)(channel * binsPerChannel);
+
+            juce::FloatVectorOperations::subtract(difference.data(), current, previous, numBins);
+            juce::FloatVectorOperations::max(difference.data(), difference.data(), 0.0f, numBins);
+            flux += VectorOps::sum(difference.data(), numBins);
+
+            juce::FloatVectorOperations::copy(previous, current, numBins);
+        }
+
+        flux *= 2.0f / (float)fftSize;
+
+        // the first frame after a reset rises from silence, don't let it count
+        if (numFramesSeen++ == 0)
+            flux = 0.0f;
+
+        Result result;
+        result.flux = flux;
+        result.threshold = thresholdMultiplier * getMedianFlux() + minimumFlux;
+
+        // a peak is only known once the following frame is lower, so decisions lag by one hop
+        auto isPeak = previousFlux > previousThreshold && previousFlux > olderFlux && previousFlux >= flux;
+        auto peakCentre = frameCentre - hopSize;
+
+        if (isPeak && (double)(peakCentre - lastOnsetSample) >= minimumIntervalSeconds * sampleRate)
+        {
+            // parabolic interpolation across the three frames puts the onset between hops
+            auto curvature = olderFlux - 2.0f * previousFlux + flux;
+            auto offset = curvature < 0.0f ? 0.5f * (olderFlux - flux) / curvature : 0.0f;
+
+            result.isOnset = true;
+            result.onsetSample = peakCentre + (juce::int64)std::lround(offset * (float)hopSize);
+            result.strength = previousFlux / previousThreshold;
+            lastOnsetSample = result.onsetSample;
+        }
+
+        fluxHistory[(size_t)historyIndex] = flux;
+        historyIndex = (historyIndex + 1) % historySize;
+
+        olderFlux = previousFlux;
+        previousFlux = flux;
+        previousThreshold = result.threshold;
+
+        return result;
+    }
+
+private:
+    static constexpr int historySize = 16;
+
+    const int binsPerChannel;
+    std::vector<float> previousMagnitudes, difference;
+
+    std::array<float, historySize> fluxHistory{};
+    int historyIndex = 0, numFramesSeen = 0;
+    float olderFlux = 0.0f, previousFlux = 0.0f, previousThreshold = 0.0f;
+    juce::int64 lastOnsetSample = std::numeric_limits<juce::int64>::min() / 2;
+
+    float getMedianFlux() const noexcept
+    {
+        auto sorted = fluxHistory;
+        std::nth_element(sorted.begin(), sorted.begin() + historySize / 2, sorted.end());
+        return sorted[historySize / 2];
+    }
+};
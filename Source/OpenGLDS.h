@@ -53,18 +53,16 @@ struct Attributes
         }
     }
 
-    void disable()
+    // Where each attribute lives in the program, -1 where it isn't used.
+    // Programs with the same signature can share a vertex array object.
+    using Signature = std::array<GLint, 4>;
+
+    Signature getSignature() const
     {
-        using namespace ::juce::gl;
+        auto location = [](const std::unique_ptr<juce::OpenGLShaderProgram::Attribute> &attribute)
+        { return attribute != nullptr ? (GLint)attribute->attributeID : -1; };
 
-        if (position != nullptr)
-            glDisableVertexAttribArray(position->attributeID);
-        if (normal != nullptr)
-            glDisableVertexAttribArray(normal->attributeID);
-        if (sourceColour != nullptr)
-            glDisableVertexAttribArray(sourceColour->attributeID);
-        if (textureCoordIn != nullptr)
-            glDisableVertexAttribArray(textureCoordIn->attributeID);
+        return {location(position), location(normal), location(sourceColour), location(textureCoordIn)};
     }
 
     std::unique_ptr<juce::OpenGLShaderProgram::Attribute> position, normal, sourceColour, textureCoordIn;
@@ -81,19 +79,68 @@ private:
     }
 };
 
+// Per-frame values every program can share, written once a frame into a uniform buffer bound at
+// frameUniformsBinding. The layout mirrors FRAME_UNIFORMS_BLOCK under std140 rules: matrices and
+// vec4s on 16 byte boundaries, then the floats packed, then padding up to a multiple of 16.
+struct FrameUniformBlock
+{
+    float projectionMatrix[16];
+    float viewMatrix[16];
+    float lightPosition[4];
+    float bouncingNumber;
+    float spectrogramHead;
+    float padding[2];
+};
+
+static_assert(sizeof(FrameUniformBlock) == 160, "FrameUniformBlock has to match the std140 layout");
+
+static constexpr GLuint frameUniformsBinding = 0;
+
+// The presets go through translateVertexShaderToV3 and translateFragmentShaderToV3, which make them
+// #version 150 on the desktop and #version 300 es on ES, so the context has to take GLSL 1.50
+// (OpenGL 3.2) or GLSL ES 3.00 (OpenGL ES 3.0). That also covers the uniform block and vertex
+// array objects. MainComponent asks for 3.2 and draws nothing when the driver hands back less.
+static bool isContextRecentEnough()
+{
+#if JUCE_OPENGL_ES
+    return juce::OpenGLShaderProgram::getLanguageVersion() >= 3.0;
+#else
+    return juce::OpenGLShaderProgram::getLanguageVersion() >= 1.5;
+#endif
+}
+
+// Every preset declares this in each stage that reads any of it. The precisions are spelled out
+// because OpenGL ES only links a block whose members match in every stage.
+#define FRAME_UNIFORMS_BLOCK                  \
+    "layout (std140) uniform FrameUniforms\n" \
+    "{\n"                                     \
+    "    highp mat4 projectionMatrix;\n"      \
+    "    highp mat4 viewMatrix;\n"            \
+    "    highp vec4 lightPosition;\n"         \
+    "    highp float bouncingNumber;\n"       \
+    "    highp float spectrogramHead;\n"      \
+    "};\n"
+
 // Uniform Values 6.4
 struct Uniforms
 {
     explicit Uniforms(juce::OpenGLShaderProgram &shader)
     {
-        projectionMatrix.reset(createUniform(shader, "projectionMatrix"));
-        viewMatrix.reset(createUniform(shader, "viewMatrix"));
+        using namespace ::juce::gl;
+
+        // the block is optimised out of a program that never reads it
+        auto blockIndex = glGetUniformBlockIndex(shader.getProgramID(), "FrameUniforms");
+
+        if (blockIndex != GL_INVALID_INDEX)
+            glUniformBlockBinding(shader.getProgramID(), blockIndex, frameUniformsBinding);
+
         texture.reset(createUniform(shader, "demoTexture"));
-        lightPosition.reset(createUniform(shader, "lightPosition"));
-        bouncingNumber.reset(createUniform(shader, "bouncingNumber"));
+        spectrumTexture.reset(createUniform(shader, "spectrumTexture"));
+        spectrogramTexture.reset(createUniform(shader, "spectrogramTexture"));
     }
 
-    std::unique_ptr<juce::OpenGLShaderProgram::Uniform> projectionMatrix, viewMatrix, texture, lightPosition, bouncingNumber;
+    // only the samplers, everything else comes from FrameUniformBuffer
+    std::unique_ptr<juce::OpenGLShaderProgram::Uniform> texture, spectrumTexture, spectrogramTexture;
 
 private:
     static juce::OpenGLShaderProgram::Uniform *createUniform(juce::OpenGLShaderProgram &shader,
@@ -108,6 +155,369 @@ private:
     }
 };
 
+// A buffer the CPU refills every frame without waiting for the GPU to finish with earlier fills.
+// It's split into numPartitions and each frame writes the next one, so the GPU can still be reading
+// the previous two. With ARB_buffer_storage the whole buffer is mapped once, persistently and
+// coherently, and a fence per partition says when it's free again. Without it each partition is
+// mapped unsynchronised as it comes round, and the buffer is orphaned at the start of every lap so
+// the driver hands over fresh storage instead of stalling on the old.
+struct StreamingBuffer
+{
+    static constexpr int numPartitions = 3;
+
+    StreamingBuffer(GLenum bufferTarget, size_t maxBytesPerFrame)
+        : target(bufferTarget),
+          partitionSize((maxBytesPerFrame + partitionAlignment - 1) / partitionAlignment * partitionAlignment)
+    {
+        using namespace ::juce::gl;
+
+        if (juce::OpenGLHelpers::isExtensionSupported("GL_ARB_buffer_storage"))
+        {
+            auto flags = (GLbitfield)(GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+
+            glGenBuffers(1, &bufferID);
+            glBindBuffer(target, bufferID);
+            glBufferStorage(target, getTotalSize(), nullptr, flags);
+            mapping = static_cast<char *>(glMapBufferRange(target, 0, getTotalSize(), flags));
+
+            // storage is immutable, so a failed mapping means starting again with a plain buffer
+            if (mapping == nullptr)
+                glDeleteBuffers(1, &bufferID);
+        }
+
+        if (mapping == nullptr)
+        {
+            glGenBuffers(1, &bufferID);
+            glBindBuffer(target, bufferID);
+            glBufferData(target, getTotalSize(), nullptr, GL_STREAM_DRAW);
+        }
+
+        glBindBuffer(target, 0);
+    }
+
+    ~StreamingBuffer()
+    {
+        using namespace ::juce::gl;
+
+        for (auto &fence : fences)
+            if (fence != nullptr)
+                glDeleteSync(fence);
+
+        if (mapping != nullptr)
+        {
+            glBindBuffer(target, bufferID);
+            glUnmapBuffer(target);
+            glBindBuffer(target, 0);
+        }
+
+        glDeleteBuffers(1, &bufferID);
+    }
+
+    // Somewhere to write up to getPartitionSize() bytes for this frame, nullptr if the driver
+    // couldn't map it. Follow with endWrite.
+    void *beginWrite()
+    {
+        using namespace ::juce::gl;
+
+        if (mapping != nullptr)
+        {
+            waitForPartition();
+            return mapping + getOffset();
+        }
+
+        glBindBuffer(target, bufferID);
+
+        if (partition == 0)
+            glBufferData(target, getTotalSize(), nullptr, GL_STREAM_DRAW);
+
+        auto *data = glMapBufferRange(target, (GLintptr)getOffset(), (GLsizeiptr)partitionSize,
+                                      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+        if (data == nullptr)
+            glBindBuffer(target, 0);
+
+        return data;
+    }
+
+    // Returns where this frame's data starts in the buffer, for glVertexAttribPointer,
+    // glBindBufferRange or a pixel unpack
+    size_t endWrite()
+    {
+        using namespace ::juce::gl;
+
+        if (mapping == nullptr)
+        {
+            glUnmapBuffer(target);
+            glBindBuffer(target, 0);
+        }
+
+        return getOffset();
+    }
+
+    // Call once the commands reading this frame's data are issued, moves on to the next partition
+    void endFrame()
+    {
+        using namespace ::juce::gl;
+
+        if (mapping != nullptr)
+            fences[(size_t)partition] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        partition = (partition + 1) % numPartitions;
+    }
+
+    GLuint getID() const noexcept { return bufferID; }
+    size_t getPartitionSize() const noexcept { return partitionSize; }
+
+private:
+    static constexpr size_t partitionAlignment = 256; // the largest uniform buffer offset alignment GL allows
+
+    const GLenum target;
+    const size_t partitionSize;
+    GLuint bufferID = 0;
+    char *mapping = nullptr; // the whole buffer, when persistently mapped
+    std::array<GLsync, numPartitions> fences{};
+    int partition = 0;
+
+    size_t getOffset() const noexcept { return (size_t)partition * partitionSize; }
+    GLsizeiptr getTotalSize() const noexcept { return (GLsizeiptr)(partitionSize * numPartitions); }
+
+    // Normally signalled long ago, the GPU is two frames behind at most
+    void waitForPartition()
+    {
+        using namespace ::juce::gl;
+
+        auto &fence = fences[(size_t)partition];
+
+        if (fence == nullptr)
+            return;
+
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+        {
+        }
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StreamingBuffer)
+};
+
+// The uniform buffer behind FRAME_UNIFORMS_BLOCK, streamed so a write never waits on the frame
+// before. Programs only need binding to frameUniformsBinding once, which Uniforms does, so
+// switching programs doesn't mean setting anything again.
+struct FrameUniformBuffer
+{
+    FrameUniformBuffer() : buffer(::juce::gl::GL_UNIFORM_BUFFER, sizeof(FrameUniformBlock)) {}
+
+    // Call before drawing
+    void write(const FrameUniformBlock &block)
+    {
+        using namespace ::juce::gl;
+
+        auto *dest = buffer.beginWrite();
+
+        if (dest == nullptr)
+            return;
+
+        std::memcpy(dest, &block, sizeof(block));
+        auto offset = buffer.endWrite();
+
+        glBindBufferRange(GL_UNIFORM_BUFFER, frameUniformsBinding, buffer.getID(), (GLintptr)offset, (GLsizeiptr)sizeof(block));
+    }
+
+    // Call once this frame's draws are issued
+    void endFrame()
+    {
+        buffer.endFrame();
+    }
+
+private:
+    StreamingBuffer buffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FrameUniformBuffer)
+};
+
+// One row of texels holding the latest spectrum, for shaders to sample as spectrumTexture.
+// The storage is allocated once and every frame overwrites it in place with glTexSubImage2D,
+// sourced from a StreamingBuffer so the upload never waits on the GPU.
+// A 2D texture of height 1 rather than a 1D one, which OpenGL ES doesn't have. The texels are
+// R16F, plenty for 0..1 and linearly filterable on OpenGL ES 3 where R32F isn't. Single channel
+// textures need ES 3 or desktop GL 3, ES 2 has no GL_RED.
+struct SpectrumTexture
+{
+    static constexpr float minDecibels = -80.0f; // maps to 0, full scale maps to 1
+
+    explicit SpectrumTexture(int numPoints)
+        : width(numPoints), pixels(::juce::gl::GL_PIXEL_UNPACK_BUFFER, sizeof(float) * (size_t)numPoints)
+    {
+        using namespace ::juce::gl;
+
+        std::vector<float> silence((size_t)width);
+
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, 1, 0, GL_RED, GL_FLOAT, silence.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    ~SpectrumTexture()
+    {
+        using namespace ::juce::gl;
+
+        glDeleteTextures(1, &textureID);
+    }
+
+    // Amplitudes where a full scale sine reads 1, stored as 0..1 on a decibel scale
+    void upload(const float *amplitudes, int numPoints)
+    {
+        using namespace ::juce::gl;
+
+        auto *texels = static_cast<float *>(pixels.beginWrite());
+
+        if (texels == nullptr)
+            return;
+
+        numPoints = juce::jmin(numPoints, width);
+
+        for (int i = 0; i < numPoints; ++i)
+            texels[i] = toTexel(amplitudes[i]);
+
+        auto offset = pixels.endWrite();
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixels.getID());
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, numPoints, 1, GL_RED, GL_FLOAT, (const GLvoid *)offset);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        pixels.endFrame();
+    }
+
+    void bind()
+    {
+        using namespace ::juce::gl;
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+    }
+
+    static float toTexel(float amplitude) noexcept
+    {
+        return juce::jlimit(0.0f, 1.0f, 1.0f - juce::Decibels::gainToDecibels(amplitude, minDecibels) / minDecibels);
+    }
+
+private:
+    const int width;
+    StreamingBuffer pixels;
+    GLuint textureID = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumTexture)
+};
+
+// The last numRows spectra as a ring, one row per analysis frame, for shaders to sample as
+// spectrogramTexture. Rows go in at a moving head instead of scrolling the image, so a frame costs
+// one row of upload. The newest row is at spectrogramHead and older ones below it, and the texture
+// repeats vertically, so texture2D (spectrogramTexture, vec2 (x, spectrogramHead - age)) just works.
+// R16F like SpectrumTexture, but sampled with GL_NEAREST, since linear filtering across the seam of
+// the repeating ring would blend the newest row into the oldest.
+struct SpectrogramTexture
+{
+    SpectrogramTexture(int numPoints, int numRowsToKeep)
+        : width(numPoints), numRows(numRowsToKeep),
+          pixels(::juce::gl::GL_PIXEL_UNPACK_BUFFER, sizeof(float) * (size_t)(numPoints * numRowsToKeep))
+    {
+        using namespace ::juce::gl;
+
+        std::vector<float> silence((size_t)(width * numRows));
+
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, numRows, 0, GL_RED, GL_FLOAT, silence.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    ~SpectrogramTexture()
+    {
+        using namespace ::juce::gl;
+
+        glDeleteTextures(1, &textureID);
+    }
+
+    // Appends rowsToAdd spectra of width amplitudes each, oldest first. However many frames the
+    // renderer fell behind by, that's one upload, or two where the ring wraps.
+    void addRows(const float *amplitudes, int rowsToAdd)
+    {
+        using namespace ::juce::gl;
+
+        // only the newest numRows can still be seen
+        if (rowsToAdd > numRows)
+        {
+            amplitudes += (size_t)(rowsToAdd - numRows) * (size_t)width;
+            rowsToAdd = numRows;
+        }
+
+        if (rowsToAdd <= 0)
+            return;
+
+        auto *texels = static_cast<float *>(pixels.beginWrite());
+
+        if (texels == nullptr)
+            return;
+
+        for (size_t i = 0; i < (size_t)(rowsToAdd * width); ++i)
+            texels[i] = SpectrumTexture::toTexel(amplitudes[i]);
+
+        auto offset = pixels.endWrite();
+        auto firstSpan = juce::jmin(rowsToAdd, numRows - nextRow);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixels.getID());
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, nextRow, width, firstSpan, GL_RED, GL_FLOAT, (const GLvoid *)offset);
+
+        if (firstSpan < rowsToAdd)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, rowsToAdd - firstSpan, GL_RED, GL_FLOAT,
+                            (const GLvoid *)(offset + sizeof(float) * (size_t)(firstSpan * width)));
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        pixels.endFrame();
+        nextRow = (nextRow + rowsToAdd) % numRows;
+    }
+
+    // Texture coordinate of the middle of the newest row
+    float getHead() const noexcept
+    {
+        return ((float)((nextRow + numRows - 1) % numRows) + 0.5f) / (float)numRows;
+    }
+
+    void bind()
+    {
+        using namespace ::juce::gl;
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+    }
+
+private:
+    const int width, numRows;
+    StreamingBuffer pixels; // a partition holds a full ring's worth of rows
+    GLuint textureID = 0;
+    int nextRow = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrogramTexture)
+};
+
 struct Shape
 {
     Shape()
@@ -117,17 +527,15 @@ struct Shape
                 vertexBuffers.add(new VertexBuffer(*s));
     }
 
+    // Leaves the last vertex array bound, the caller puts back whatever it needs afterwards
     void draw(Attributes &attributes)
     {
         using namespace ::juce::gl;
 
         for (auto *vertexBuffer : vertexBuffers)
         {
-            vertexBuffer->bind();
-
-            attributes.enable();
+            vertexBuffer->bindVertexArray(attributes);
             glDrawElements(GL_TRIANGLES, vertexBuffer->numIndices, GL_UNSIGNED_INT, nullptr);
-            attributes.disable();
         }
     }
 
@@ -159,20 +567,52 @@ private:
         {
             using namespace ::juce::gl;
 
+            for (auto &vertexArray : vertexArrays)
+                glDeleteVertexArrays(1, &vertexArray.id);
+
             glDeleteBuffers(1, &vertexBuffer);
             glDeleteBuffers(1, &indexBuffer);
         }
 
-        void bind()
+        // Binds the vertex array for this attribute layout, which records the buffers and attribute
+        // pointers the first time a layout is seen, so later draws don't specify them again.
+        // Vertex arrays are core from OpenGL 3.0 and ES 3.0, see isContextRecentEnough.
+        void bindVertexArray(Attributes &attributes)
         {
             using namespace ::juce::gl;
 
+            auto signature = attributes.getSignature();
+
+            for (auto &vertexArray : vertexArrays)
+            {
+                if (vertexArray.signature == signature)
+                {
+                    glBindVertexArray(vertexArray.id);
+                    return;
+                }
+            }
+
+            GLuint id = 0;
+            glGenVertexArrays(1, &id);
+            glBindVertexArray(id);
+
+            // the element buffer binding is part of the vertex array, the array buffer is captured by the pointers
             glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+            attributes.enable();
+
+            vertexArrays.push_back({signature, id});
         }
 
+        struct VertexArray
+        {
+            Attributes::Signature signature;
+            GLuint id;
+        };
+
         GLuint vertexBuffer, indexBuffer;
         int numIndices;
+        std::vector<VertexArray> vertexArrays; // one per attribute layout drawn with so far
 
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VertexBuffer)
     };
@@ -274,9 +714,7 @@ static juce::Array<ShaderPreset> getPresets()
              "attribute vec4 sourceColour;\n"
              "attribute vec2 textureCoordIn;\n"
              "\n"
-             "uniform mat4 projectionMatrix;\n"
-             "uniform mat4 viewMatrix;\n"
-             "uniform vec4 lightPosition;\n"
+             FRAME_UNIFORMS_BLOCK
              "\n"
              "varying vec4 destinationColour;\n"
              "varying vec2 textureCoordOut;\n"
@@ -325,8 +763,7 @@ static juce::Array<ShaderPreset> getPresets()
              "attribute vec4 sourceColour;\n"
              "attribute vec2 textureCoordIn;\n"
              "\n"
-             "uniform mat4 projectionMatrix;\n"
-             "uniform mat4 viewMatrix;\n"
+             FRAME_UNIFORMS_BLOCK
              "\n"
              "varying vec4 destinationColour;\n"
              "varying vec2 textureCoordOut;\n"
@@ -361,8 +798,7 @@ static juce::Array<ShaderPreset> getPresets()
              "attribute vec4 sourceColour;\n"
              "attribute vec2 textureCoordIn;\n"
              "\n"
-             "uniform mat4 projectionMatrix;\n"
-             "uniform mat4 viewMatrix;\n"
+             FRAME_UNIFORMS_BLOCK
              "\n"
              "varying vec4 destinationColour;\n"
              "varying vec2 textureCoordOut;\n"
@@ -395,8 +831,7 @@ static juce::Array<ShaderPreset> getPresets()
              "attribute vec4 sourceColour;\n"
              "attribute vec2 textureCoordIn;\n"
              "\n"
-             "uniform mat4 projectionMatrix;\n"
-             "uniform mat4 viewMatrix;\n"
+             FRAME_UNIFORMS_BLOCK
              "\n"
              "varying vec4 destinationColour;\n"
              "varying vec2 textureCoordOut;\n"
@@ -440,8 +875,7 @@ static juce::Array<ShaderPreset> getPresets()
              "attribute vec4 position;\n"
              "attribute vec2 textureCoordIn;\n"
              "\n"
-             "uniform mat4 projectionMatrix;\n"
-             "uniform mat4 viewMatrix;\n"
+             FRAME_UNIFORMS_BLOCK
              "\n"
              "varying vec2 textureCoordOut;\n"
              "\n"
@@ -460,7 +894,7 @@ static juce::Array<ShaderPreset> getPresets()
 #else
              "varying vec2 textureCoordOut;\n"
 #endif
-             "uniform float bouncingNumber;\n"
+             FRAME_UNIFORMS_BLOCK
              "\n"
              "void main()\n"
              "{\n"
@@ -479,9 +913,7 @@ static juce::Array<ShaderPreset> getPresets()
              "attribute vec4 position;\n"
              "attribute vec4 normal;\n"
              "\n"
-             "uniform mat4 projectionMatrix;\n"
-             "uniform mat4 viewMatrix;\n"
-             "uniform vec4 lightPosition;\n"
+             FRAME_UNIFORMS_BLOCK
              "\n"
              "varying float lightIntensity;\n"
              "\n"
@@ -519,9 +951,7 @@ static juce::Array<ShaderPreset> getPresets()
              "attribute vec4 position;\n"
              "attribute vec4 normal;\n"
              "\n"
-             "uniform mat4 projectionMatrix;\n"
-             "uniform mat4 viewMatrix;\n"
-             "uniform vec4 lightPosition;\n"
+             FRAME_UNIFORMS_BLOCK
              "\n"
              "varying float lightIntensity;\n"
              "\n"
@@ -562,9 +992,7 @@ static juce::Array<ShaderPreset> getPresets()
              "attribute vec4 position;\n"
              "attribute vec4 normal;\n"
              "\n"
-             "uniform mat4 projectionMatrix;\n"
-             "uniform mat4 viewMatrix;\n"
-             "uniform vec4 lightPosition;\n"
+             FRAME_UNIFORMS_BLOCK
              "\n"
              "varying float lightIntensity;\n"
              "\n"
@@ -603,6 +1031,73 @@ static juce::Array<ShaderPreset> getPresets()
              "        colour  = vec4 (0.2, 0.1, 0.1, 1.0);\n"
              "\n"
              "    gl_FragColor = colour;\n"
+             "}\n"},
+
+            {"Spectrum",
+
+             SHADER_DEMO_HEADER
+             "attribute vec4 position;\n"
+             "attribute vec2 textureCoordIn;\n"
+             "\n"
+             FRAME_UNIFORMS_BLOCK
+             "\n"
+             "varying vec2 textureCoordOut;\n"
+             "\n"
+             "void main()\n"
+             "{\n"
+             "    textureCoordOut = textureCoordIn;\n"
+             "    gl_Position = projectionMatrix * viewMatrix * position;\n"
+             "}\n",
+
+             SHADER_DEMO_HEADER
+#if JUCE_OPENGL_ES
+             "precision mediump float;\n"
+             "varying lowp vec2 textureCoordOut;\n"
+#else
+             "varying vec2 textureCoordOut;\n"
+#endif
+             "uniform sampler2D spectrumTexture;\n"
+             "\n"
+             "void main()\n"
+             "{\n"
+             "    float level = texture2D (spectrumTexture, vec2 (textureCoordOut.x, 0.5)).r;\n"
+             "    float lit = step (textureCoordOut.y, level);\n"
+             "\n"
+             "    gl_FragColor = vec4 (level, 0.4 * lit, 1.0 - level, 1.0) * (0.3 + 0.7 * lit);\n"
+             "}\n"},
+
+            {"Spectrogram",
+
+             SHADER_DEMO_HEADER
+             "attribute vec4 position;\n"
+             "attribute vec2 textureCoordIn;\n"
+             "\n"
+             FRAME_UNIFORMS_BLOCK
+             "\n"
+             "varying vec2 textureCoordOut;\n"
+             "\n"
+             "void main()\n"
+             "{\n"
+             "    textureCoordOut = textureCoordIn;\n"
+             "    gl_Position = projectionMatrix * viewMatrix * position;\n"
+             "}\n",
+
+             SHADER_DEMO_HEADER
+#if JUCE_OPENGL_ES
+             "precision mediump float;\n"
+             "varying lowp vec2 textureCoordOut;\n"
+#else
+             "varying vec2 textureCoordOut;\n"
+#endif
+             FRAME_UNIFORMS_BLOCK
+             "uniform sampler2D spectrogramTexture;\n"
+             "\n"
+             "void main()\n"
+             "{\n"
+             "    // newest at the top, oldest at the bottom\n"
+             "    float level = texture2D (spectrogramTexture, vec2 (textureCoordOut.x, spectrogramHead - (1.0 - textureCoordOut.y))).r;\n"
+             "\n"
+             "    gl_FragColor = vec4 (level, level * level, 1.0 - level, 1.0);\n"
              "}\n"}};
 
     return Array<ShaderPreset>(presets, numElementsInArray(presets));
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Fundamental frequency of a monophonic signal by McLeod's pitch method.
+// The normalised square difference function is 2 r(t) / m(t), where r is the autocorrelation and m
+// the energy of the two overlapping parts. r comes from one forward and one inverse FFT of the
+// zero padded window and m is updated one lag at a time, so a window costs O(N log N) instead of
+// the O(N^2) of working out every lag directly. The first peak close to the highest one is the
+// period, and its height says how periodic the window is.
+class PitchDetector
+{
+public:
+    struct Result
+    {
+        float frequency = 0.0f; // Hz, 0 when the window isn't clearly periodic
+        float clarity = 0.0f;   // 0..1, height of the chosen peak
+    };
+
+    static constexpr int windowOrder = 11, windowSize = 1 << windowOrder; // ~46 ms at 44.1 kHz
+    static constexpr float minFrequency = 50.0f, maxFrequency = 2000.0f;
+
+    float peakThreshold = 0.9f; // fraction of the highest peak the first acceptable peak has to reach
+    float minimumClarity = 0.5f;
+
+    PitchDetector() : fft(windowOrder + 1), correlation((size_t)windowSize * 4), nsdf((size_t)windowSize) {}
+
+    void reset() noexcept
+    {
+        history.fill(0.0f);
+        writeIndex = samplesSeen = 0;
+        result = {};
+    }
+
+    // Appends new samples to the window
+    void push(const float *samples, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            history[(size_t)writeIndex] = samples[i];
+            writeIndex = (writeIndex + 1) & (windowSize - 1);
+        }
+
+        samplesSeen = juce::jmin(windowSize, samplesSeen + numSamples);
+    }
+
+    // Estimates the pitch of the latest windowSize samples
+    Result process(double sampleRate) noexcept
+    {
+        if (samplesSeen < windowSize)
+            return result = {};
+
+        auto *x = correlation.data();
+
+        // oldest sample first, zero padded to twice the window so the autocorrelation doesn't wrap
+        std::copy(history.begin() + writeIndex, history.end(), x);
+        std::copy(history.begin(), history.begin() + writeIndex, x + windowSize - writeIndex);
+        std::fill(x + windowSize, x + correlation.size(), 0.0f);
+
+        auto energy = 0.0;
+
+        for (int i = 0; i < windowSize; ++i)
+            energy += (double)x[i] * x[i];
+
+        if (energy < 1.0e-8)
+            return result = {};
+
+        // m(t) starts at twice the energy and loses the sample at each end as the lag grows
+        auto m = 2.0 * energy;
+        nsdf[0] = (float)m;
+
+        for (int lag = 1; lag < windowSize; ++lag)
+        {
+            auto first = (double)x[lag - 1], last = (double)x[windowSize - lag];
+            m -= first * first + last * last;
+            nsdf[(size_t)lag] = (float)juce::jmax(m, 1.0e-12);
+        }
+
+        // r(t) is the inverse transform of the power spectrum
+        fft.performRealOnlyForwardTransform(x, true);
+
+        for (int bin = 0; bin <= windowSize; ++bin)
+        {
+            x[2 * bin] = x[2 * bin] * x[2 * bin] + x[2 * bin + 1] * x[2 * bin + 1];
+            x[2 * bin + 1] = 0.0f;
+        }
+
+        fft.performRealOnlyInverseTransform(x);
+
+        // whatever scaling the FFT uses, r(0) has to equal the energy
+        auto scale = (float)(energy / juce::jmax(1.0e-12f, x[0]));
+
+        for (int lag = 0; lag < windowSize; ++lag)
+            nsdf[(size_t)lag] = 2.0f * scale * x[lag] / nsdf[(size_t)lag];
+
+        return result = pickPeak(sampleRate);
+    }
+
+private:
+    juce::dsp::FFT fft;
+    std::vector<float> correlation, nsdf;
+
+    std::array<float, windowSize> history{};
+    int writeIndex = 0, samplesSeen = 0;
+    Result result;
+
+    // Key maxima are the highest points between a rising and the next falling zero crossing,
+    // skipping the lobe around lag 0. The first within peakThreshold of the best wins.
+    Result pickPeak(double sampleRate) const noexcept
+    {
+        auto minLag = juce::jmax(2, (int)(sampleRate / maxFrequency));
+        auto maxLag = juce::jmin(windowSize - 2, (int)(sampleRate / minFrequency));
+
+        std::array<int, 64> peaks{};
+        int numPeaks = 0, lag = 1;
+        float highest = 0.0f;
+
+        while (lag < maxLag && nsdf[(size_t)lag] > 0.0f)
+            ++lag;
+
+        while (lag < maxLag && numPeaks < (int)peaks.size())
+        {
+            while (lag < maxLag && nsdf[(size_t)lag] <= 0.0f)
+                ++lag;
+
+            auto best = lag;
+
+            while (lag < maxLag && nsdf[(size_t)lag] > 0.0f)
+            {
+                if (nsdf[(size_t)lag] > nsdf[(size_t)best])
+                    best = lag;
+
+                ++lag;
+            }
+
+            if (best >= minLag && best < maxLag && nsdf[(size_t)best] > 0.0f)
+            {
+                peaks[(size_t)numPeaks++] = best;
+                highest = juce::jmax(highest, nsdf[(size_t)best]);
+            }
+        }
+
+        for (int i = 0; i < numPeaks; ++i)
+        {
+            auto peak = peaks[(size_t)i];
+
+            if (nsdf[(size_t)peak] < peakThreshold * highest)
+                continue;
+
+            auto a = nsdf[(size_t)peak - 1], b = nsdf[(size_t)peak], c = nsdf[(size_t)peak + 1];
+            auto curvature = a - 2.0f * b + c;
+            auto offset = curvature < 0.0f ? 0.5f * (a - c) / curvature : 0.0f;
+            auto clarity = juce::jmin(1.0f, b - 0.25f * (a - c) * offset);
+
+            if (clarity < minimumClarity)
+                break;
+
+            return {(float)(sampleRate / ((float)peak + offset)), clarity};
+        }
+
+        return {};
+    }
+};
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "LockFree.h"
+
+// Short-time Fourier transform framing.
+// Frames are windowed straight out of the audio fifo and the fifo is advanced by one hop per frame,
+// so the analysis rate is set by the overlap rather than by whoever drains the audio fifo.
+// Each FFT size is its own FixedSizeSTFT instantiation with tables built at compile time,
+// STFT is the runtime interface used to switch between them.
+class STFT
+{
+public:
+    enum class Window
+    {
+        hann,
+        blackmanHarris
+    };
+
+    // Value is the number of hops per frame
+    enum class Overlap
+    {
+        half = 2,
+        threeQuarters = 4,
+        sevenEighths = 8
+    };
+
+    static constexpr int minOrder = 8, maxOrder = 14; // 256 to 16384 points
+    static constexpr int maxSize = 1 << maxOrder;
+
+    virtual ~STFT() = default;
+
+    // Not thread safe, call from the thread that reads frames
+    void setWindow(Window newWindow) { windowType = newWindow; }
+    void setOverlap(Overlap newOverlap) { overlap = newOverlap; }
+
+    int getOrder() const noexcept { return order; }
+    int getSize() const noexcept { return 1 << order; }
+    int getNumBins() const noexcept { return getSize() / 2 + 1; }
+    int getHopSize() const noexcept { return getSize() / (int)overlap; }
+    Window getWindow() const noexcept { return windowType; }
+    Overlap getOverlap() const noexcept { return overlap; }
+
+    // Writes the next windowed frame of each fifo lane into its own row of dest, rows are 2 * maxSize apart.
+    // Each row holds the frame in [0, size) and zeroes in [size, 2 * size) so it can be handed straight
+    // to the FFT. The window multiply is fused into the copy out of the fifo, which takes at most
+    // two spans per lane. Returns false until a whole frame is waiting.
+    virtual bool readFrame(SpscRingBuffer<float> &fifo, int numChannels, float *dest) = 0;
+
+    // Replaces the first getNumBins() values of each row with its magnitude spectrum
+    virtual void performFrequencyOnlyForwardTransform(float *rows, int numChannels) const = 0;
+
+    // Replaces the first 2 * getNumBins() values of each row with its complex spectrum as interleaved
+    // real and imaginary parts, for analysers that need phase
+    virtual void performRealOnlyForwardTransform(float *rows, int numChannels) const = 0;
+
+    // Turns rows left by performRealOnlyForwardTransform into what performFrequencyOnlyForwardTransform gives
+    void convertToMagnitudes(float *rows, int numChannels) const noexcept
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto *row = rows + (size_t)channel * 2 * maxSize;
+
+            // bin k only ever overwrites values already read, so this can run in place
+            for (int k = 0; k < getNumBins(); ++k)
+                row[k] = std::hypot(row[2 * k], row[2 * k + 1]);
+        }
+    }
+
+    // The window currently applied by readFrame, getSize() values
+    virtual const float *getWindowTable() const noexcept = 0;
+
+    // Centre frequency of each bin as a fraction of the sample rate
+    virtual const float *getNormalisedBinFrequencies() const noexcept = 0;
+
+    static std::unique_ptr<STFT> create(int order);
+
+protected:
+    explicit STFT(int fftOrder) : order(fftOrder) {}
+
+    const int order;
+    Window windowType = Window::hann;
+    Overlap overlap = Overlap::threeQuarters;
+
+    JUCE_DECLARE_NON_COPYABLE(STFT)
+};
+
+namespace STFTTables
+{
+    // cos (2 pi i / size) for every i. std::cos isn't constexpr, so seed the Chebyshev
+    // recurrence with a Taylor series for the first step and run it in double precision.
+    template <int Size>
+    constexpr std::array<double, Size> makeCosines()
+    {
+        constexpr double theta = juce::MathConstants<double>::twoPi / Size;
+
+        double c = 1.0, term = 1.0;
+
+        for (int n = 1; n < 12; ++n)
+        {
+            term *= -theta * theta / ((2 * n - 1) * (2 * n));
+            c += term;
+        }
+
+        std::array<double, Size> cosines{};
+        cosines[0] = 1.0;
+        cosines[1] = c;
+
+        for (size_t i = 2; i < (size_t)Size; ++i)
+            cosines[i] = 2.0 * c * cosines[i - 1] - cosines[i - 2];
+
+        return cosines;
+    }
+
+    // Periodic windows scaled to unity coherent gain, so a full scale sine reads the same
+    // magnitude it did with the old rectangular frames
+    template <int Size>
+    constexpr std::array<float, Size> makeWindow(STFT::Window type)
+    {
+        auto cosines = makeCosines<Size>();
+        std::array<double, Size> w{};
+        double sum = 0.0;
+
+        for (size_t i = 0; i < (size_t)Size; ++i)
+        {
+            auto c1 = cosines[i];
+            auto c2 = 2.0 * c1 * c1 - 1.0;
+            auto c3 = (4.0 * c1 * c1 - 3.0) * c1;
+
+            w[i] = type == STFT::Window::hann
+                       ? 0.5 - 0.5 * c1
+                       : 0.35875 - 0.48829 * c1 + 0.14128 * c2 - 0.01168 * c3;
+            sum += w[i];
+        }
+
+        std::array<float, Size> window{};
+
+        for (size_t i = 0; i < (size_t)Size; ++i)
+            window[i] = (float)(w[i] * Size / sum);
+
+        return window;
+    }
+
+    template <int Size>
+    constexpr std::array<float, Size / 2 + 1> makeBinFrequencies()
+    {
+        std::array<float, Size / 2 + 1> frequencies{};
+
+        for (size_t i = 0; i < frequencies.size(); ++i)
+            frequencies[i] = (float)((double)i / Size);
+
+        return frequencies;
+    }
+}
+
+template <int Order>
+class FixedSizeSTFT final : public STFT
+{
+public:
+    static constexpr int size = 1 << Order;
+    static constexpr int numBins = size / 2 + 1;
+
+    static constexpr std::array<float, size> hannWindow = STFTTables::makeWindow<size>(Window::hann);
+    static constexpr std::array<float, size> blackmanHarrisWindow = STFTTables::makeWindow<size>(Window::blackmanHarris);
+    static constexpr std::array<float, numBins> binFrequencies = STFTTables::makeBinFrequencies<size>();
+
+    FixedSizeSTFT() : STFT(Order), fft(Order) {}
+
+    bool readFrame(SpscRingBuffer<float> &fifo, int numChannels, float *dest) override
+    {
+        if (fifo.getNumReady() < size)
+            return false;
+
+        auto *w = getWindowTable();
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto *row = dest + (size_t)channel * 2 * maxSize;
+
+            fifo.peek(channel, size, [row, w](const float *src, int offset, int count)
+                      { juce::FloatVectorOperations::multiply(row + offset, src, w + offset, count); });
+
+            juce::FloatVectorOperations::clear(row + size, size);
+        }
+
+        fifo.discard(getHopSize());
+        return true;
+    }
+
+    void performFrequencyOnlyForwardTransform(float *rows, int numChannels) const override
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            fft.performFrequencyOnlyForwardTransform(rows + (size_t)channel * 2 * maxSize, true);
+    }
+
+    void performRealOnlyForwardTransform(float *rows, int numChannels) const override
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            fft.performRealOnlyForwardTransform(rows + (size_t)channel * 2 * maxSize, true);
+    }
+
+    const float *getNormalisedBinFrequencies() const noexcept override { return binFrequencies.data(); }
+
+    const float *getWindowTable() const noexcept override
+    {
+        return windowType == Window::hann ? hannWindow.data() : blackmanHarrisWindow.data();
+    }
+
+private:
+    juce::dsp::FFT fft;
+};
+
+inline std::unique_ptr<STFT> STFT::create(int order)
+{
+    switch (order)
+    {
+    case 8:
+        return std::make_unique<FixedSizeSTFT<8>>();
+    case 9:
+        return std::make_unique<FixedSizeSTFT<9>>();
+    case 10:
+        return std::make_unique<FixedSizeSTFT<10>>();
+    case 11:
+        return std::make_unique<FixedSizeSTFT<11>>();
+    case 12:
+        return std::make_unique<FixedSizeSTFT<12>>();
+    case 13:
+        return std::make_unique<FixedSizeSTFT<13>>();
+    case 14:
+        return std::make_unique<FixedSizeSTFT<14>>();
+    default:
+        jassertfalse;
+        return nullptr;
+    }
+}
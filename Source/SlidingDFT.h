@@ -0,0 +1,75 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Sliding DFT at a handful of chosen frequencies, updated every sample.
+// Each bin is a complex one-pole resonator, S[n] = x[n] + r e^(i w) S[n - 1], which is a sliding
+// DFT with an exponential window instead of a rectangular one. With r < 1 rounding errors die away
+// instead of piling up as they do in the classic recursion, no delay line is needed, and each bin
+// gets its own bandwidth so a kick fundamental and a hi-hat band can be tracked side by side.
+// State is one array per quantity and the per sample loop runs across bins so it vectorises.
+class SlidingDFTBank
+{
+public:
+    static constexpr int maxBins = 64;
+
+    // Not thread safe, call from the thread that calls process. Bandwidths are in Hz,
+    // narrower resolves closer frequencies but reacts more slowly.
+    void setFrequencies(const float *frequencies, const float *bandwidths, int num, double sampleRate) noexcept
+    {
+        numBins = juce::jlimit(0, maxBins, num);
+
+        for (size_t k = 0; k < (size_t)numBins; ++k)
+        {
+            auto w = juce::MathConstants<double>::twoPi * frequencies[k] / sampleRate;
+            auto r = std::exp(-juce::MathConstants<double>::pi * juce::jmax(bandwidths[k], 0.1f) / sampleRate);
+
+            cosines[k] = (float)(r * std::cos(w));
+            sines[k] = (float)(r * std::sin(w));
+            scales[k] = (float)(2.0 * (1.0 - r)); // full scale sine at the bin frequency reads 1
+        }
+
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        real.fill(0.0f);
+        imag.fill(0.0f);
+    }
+
+    void process(const float *input, int numSamples) noexcept
+    {
+        auto *re = real.data();
+        auto *im = imag.data();
+        auto *c = cosines.data();
+        auto *s = sines.data();
+        auto num = numBins;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto x = input[i];
+
+            for (int k = 0; k < num; ++k)
+            {
+                auto r = x + c[k] * re[k] - s[k] * im[k];
+                im[k] = c[k] * im[k] + s[k] * re[k];
+                re[k] = r;
+            }
+        }
+    }
+
+    int getNumBins() const noexcept { return numBins; }
+
+    // Writes getNumBins() amplitudes as of the last sample processed
+    void getMagnitudes(float *dest) const noexcept
+    {
+        for (size_t k = 0; k < (size_t)numBins; ++k)
+            dest[k] = scales[k] * std::sqrt(real[k] * real[k] + imag[k] * imag[k]);
+    }
+
+private:
+    int numBins = 0;
+    alignas(32) std::array<float, maxBins> real{}, imag{};
+    alignas(32) std::array<float, maxBins> cosines{}, sines{}, scales{};
+};
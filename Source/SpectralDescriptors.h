@@ -0,0 +1,197 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "VectorOps.h"
+
+// Spectral shape descriptors of each analysed channel, plus the zero crossing rate of its samples.
+// Centroid, spread, flatness and flux all come out of one pass over the magnitudes that keeps every
+// running sum in numLanes independent lanes, the same way VectorOps does, so the compiler can keep
+// them in vector registers. Flatness takes its logs with approximateLog, plain arithmetic that
+// vectorises where a call into libm wouldn't. Rolloff needs the total energy first and takes a
+// second pass, which stops as soon as the block holding the rolloff point is found.
+class SpectralDescriptors
+{
+public:
+    struct Result
+    {
+        float centroid = 0.0f;         // Hz, magnitude weighted mean frequency
+        float spread = 0.0f;           // Hz, magnitude weighted standard deviation around the centroid
+        float rolloff = 0.0f;          // Hz, below which rolloffFraction of the energy lies
+        float flatness = 0.0f;         // geometric over arithmetic mean of the magnitudes, near 0 for a pure tone
+        float flux = 0.0f;             // Euclidean distance from the previous frame's magnitudes, scaled by 2 / fftSize like the levels
+        float zeroCrossingRate = 0.0f; // fraction of consecutive samples that change sign since the last frame
+    };
+
+    float rolloffFraction = 0.85f;
+
+    SpectralDescriptors(int maxChannels, int maxBins)
+        : binsPerChannel(maxBins),
+          previousMagnitudes((size_t)(maxChannels * maxBins)),
+          channels((size_t)maxChannels)
+    {
+    }
+
+    // Call when the bins stop meaning the same thing, e.g. the FFT size or channel layout changed
+    void reset() noexcept
+    {
+        std::fill(previousMagnitudes.begin(), previousMagnitudes.end(), 0.0f);
+
+        for (auto &channel : channels)
+            channel = {};
+    }
+
+    // Counts sign changes in new samples of one channel, can be called several times between process
+    void countZeroCrossings(int channel, const float *samples, int numSamples) noexcept
+    {
+        if (numSamples <= 0)
+            return;
+
+        auto &state = channels[(size_t)channel];
+        int crossings = (state.lastSample >= 0.0f) != (samples[0] >= 0.0f);
+
+        for (int i = 1; i < numSamples; ++i)
+            crossings += (samples[i - 1] >= 0.0f) != (samples[i] >= 0.0f);
+
+        state.crossings += crossings;
+        state.samplesSeen += numSamples;
+        state.lastSample = samples[numSamples - 1];
+    }
+
+    // magnitudes holds bins 0 to numBins - 1 of an fftSize transform
+    Result process(int channel, const float *magnitudes, int numBins, int fftSize, double sampleRate) noexcept
+    {
+        jassert(numBins <= binsPerChannel);
+
+        auto *previous = previousMagnitudes.data() + (size_t)(channel * binsPerChannel);
+        auto &state = channels[(size_t)channel];
+
+        // DC says nothing about shape, start at bin 1
+        float amplitude[numLanes] = {}, moment1[numLanes] = {}, moment2[numLanes] = {};
+        float energy[numLanes] = {}, logAmplitude[numLanes] = {}, change[numLanes] = {};
+        int i = 1;
+
+        for (; i + numLanes <= numBins; i += numLanes)
+            for (int j = 0; j < numLanes; ++j)
+            {
+                auto m = magnitudes[i + j], k = (float)(i + j);
+                auto p = m * m, d = m - previous[i + j];
+
+                amplitude[j] += m;
+                moment1[j] += m * k;
+                moment2[j] += m * k * k;
+                energy[j] += p;
+                logAmplitude[j] += approximateLog(m + magnitudeFloor);
+                change[j] += d * d;
+                previous[i + j] = m;
+            }
+
+        auto sumAmplitude = 0.0f, sumMoment1 = 0.0f, sumMoment2 = 0.0f;
+        auto sumEnergy = 0.0f, sumLogAmplitude = 0.0f, sumChange = 0.0f;
+
+        for (; i < numBins; ++i)
+        {
+            auto m = magnitudes[i], k = (float)i;
+            auto p = m * m, d = m - previous[i];
+
+            sumAmplitude += m;
+            sumMoment1 += m * k;
+            sumMoment2 += m * k * k;
+            sumEnergy += p;
+            sumLogAmplitude += approximateLog(m + magnitudeFloor);
+            sumChange += d * d;
+            previous[i] = m;
+        }
+
+        for (int j = 0; j < numLanes; ++j)
+        {
+            sumAmplitude += amplitude[j];
+            sumMoment1 += moment1[j];
+            sumMoment2 += moment2[j];
+            sumEnergy += energy[j];
+            sumLogAmplitude += logAmplitude[j];
+            sumChange += change[j];
+        }
+
+        Result result;
+        auto binWidth = (float)(sampleRate / fftSize);
+        auto numShapeBins = (float)juce::jmax(1, numBins - 1);
+
+        result.flux = state.primed ? std::sqrt(sumChange) * 2.0f / (float)fftSize : 0.0f;
+        state.primed = true;
+
+        result.zeroCrossingRate = state.samplesSeen > 0 ? (float)state.crossings / (float)state.samplesSeen : 0.0f;
+        state.crossings = state.samplesSeen = 0;
+
+        if (sumAmplitude > 1.0e-9f)
+        {
+            auto centroidBin = sumMoment1 / sumAmplitude;
+            result.centroid = centroidBin * binWidth;
+            result.spread = std::sqrt(juce::jmax(0.0f, sumMoment2 / sumAmplitude - centroidBin * centroidBin)) * binWidth;
+            result.rolloff = findRolloff(magnitudes, numBins, rolloffFraction * sumEnergy) * binWidth;
+
+            auto geometricMean = std::exp(sumLogAmplitude / numShapeBins);
+            result.flatness = juce::jlimit(0.0f, 1.0f, geometricMean / (sumAmplitude / numShapeBins + magnitudeFloor));
+        }
+
+        return result;
+    }
+
+private:
+    static constexpr int numLanes = VectorOps::numLanes;
+    static constexpr float magnitudeFloor = 1.0e-6f; // keeps the log finite in empty bins
+
+    struct ChannelState
+    {
+        float lastSample = 0.0f;
+        int crossings = 0, samplesSeen = 0;
+        bool primed = false;
+    };
+
+    const int binsPerChannel;
+    std::vector<float> previousMagnitudes;
+    std::vector<ChannelState> channels;
+
+    // Natural log from the float's exponent and a quartic in its mantissa, good to about 1e-4,
+    // which is plenty for a mean. Only arithmetic and bit moves, so the loop above still vectorises.
+    static float approximateLog(float x) noexcept
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+
+        auto exponent = (float)((int)(bits >> 23) - 127);
+        bits = (bits & 0x007fffffu) | 0x3f800000u; // mantissa as a float in [1, 2)
+
+        float m;
+        std::memcpy(&m, &bits, sizeof(m));
+
+        auto log2Mantissa = -2.4983532f + (4.0292114f + (-2.0783352f + (0.62603218f - 0.078440676f * m) * m) * m) * m;
+        return (exponent + log2Mantissa) * 0.69314718f; // ln 2
+    }
+
+    // Whole blocks of energy until the target falls inside one, then bin by bin within it
+    static float findRolloff(const float *magnitudes, int numBins, float target) noexcept
+    {
+        auto cumulative = 0.0f;
+        int i = 1;
+
+        for (; i + numLanes <= numBins; i += numLanes)
+        {
+            auto block = VectorOps::dotProduct(magnitudes + i, magnitudes + i, numLanes);
+
+            if (cumulative + block >= target)
+                break;
+
+            cumulative += block;
+        }
+
+        for (; i < numBins; ++i)
+        {
+            cumulative += magnitudes[i] * magnitudes[i];
+
+            if (cumulative >= target)
+                return (float)i;
+        }
+
+        return (float)(numBins - 1);
+    }
+};
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Tempo and beat phase from the onset strength of successive analysis frames.
+// Flux is resampled onto a fixed 100 Hz grid so the cost doesn't depend on FFT size or overlap.
+// Each grid cell updates a leaky autocorrelation over a few seconds one lag at a time, rather than
+// recomputing the window, and a phase accumulator running at the chosen period folds onsets into
+// a single complex sum whose angle says where the beat falls.
+class TempoTracker
+{
+public:
+    struct Result
+    {
+        float bpm = 0.0f;
+        float beatPhase = 0.0f;  // 0 on the beat, rising to 1 just before the next one
+        float confidence = 0.0f; // 0..1, how periodic the recent onsets are
+    };
+
+    static constexpr double envelopeRate = 100.0; // grid cells per second
+    static constexpr float minBPM = 60.0f, maxBPM = 200.0f;
+
+    TempoTracker()
+    {
+        // log-normal prior around 120 BPM steers the pick clear of half and double time
+        for (int lag = minLag; lag <= maxLag; ++lag)
+        {
+            auto octavesFrom120 = std::log2(lagToBPM((float)lag) / 120.0f);
+            tempoPrior[(size_t)lag] = std::exp(-0.5f * octavesFrom120 * octavesFrom120);
+        }
+    }
+
+    void reset()
+    {
+        history.fill(0.0f);
+        autocorrelation.fill(0.0f);
+        historyIndex = 0;
+        nextCellStart = 0.0;
+        started = false;
+        cellPeak = runningMean = 0.0f;
+        beatAngle = 0.0;
+        beatSum = {};
+        result = {};
+    }
+
+    // flux is the onset strength of the frame centred on frameCentre
+    Result process(float flux, juce::int64 frameCentre, double sampleRate) noexcept
+    {
+        auto cellLength = sampleRate / envelopeRate;
+
+        if (!started)
+        {
+            nextCellStart = (double)frameCentre + cellLength;
+            started = true;
+        }
+
+        // close every cell that ended before this frame, cells no frame landed in count as silence
+        while ((double)frameCentre >= nextCellStart)
+        {
+            processCell(cellPeak);
+            cellPeak = 0.0f;
+            nextCellStart += cellLength;
+        }
+
+        cellPeak = juce::jmax(cellPeak, flux);
+        return result;
+    }
+
+private:
+    static constexpr int minLag = (int)(60.0 * envelopeRate / maxBPM);
+    static constexpr int maxLag = (int)(60.0 * envelopeRate / minBPM);
+    static constexpr int historySize = maxLag + 1;
+
+    const float autocorrelationDecay = std::exp(-1.0f / (4.0f * (float)envelopeRate)); // ~4s memory
+    const float phaseDecay = std::exp(-1.0f / (2.0f * (float)envelopeRate));          // ~2s memory
+    const float meanDecay = std::exp(-1.0f / (1.0f * (float)envelopeRate));
+
+    std::array<float, historySize> history{};
+    std::array<float, historySize> autocorrelation{};
+    std::array<float, historySize> tempoPrior{};
+    int historyIndex = 0;
+
+    double nextCellStart = 0.0;
+    bool started = false;
+    float cellPeak = 0.0f, runningMean = 0.0f;
+
+    double beatAngle = 0.0;
+    std::complex<float> beatSum;
+    Result result;
+
+    void processCell(float onsetStrength) noexcept
+    {
+        // remove the slowly varying part so the autocorrelation sees rhythm rather than level
+        runningMean = meanDecay * runningMean + (1.0f - meanDecay) * onsetStrength;
+        auto x = juce::jmax(0.0f, onsetStrength - runningMean);
+
+        historyIndex = (historyIndex + 1) % historySize;
+        history[(size_t)historyIndex] = x;
+
+        for (int lag = 0; lag <= maxLag; ++lag)
+        {
+            auto past = history[(size_t)((historyIndex - lag + historySize) % historySize)];
+            autocorrelation[(size_t)lag] = autocorrelationDecay * autocorrelation[(size_t)lag] + x * past;
+        }
+
+        auto bestLag = minLag;
+        auto bestScore = 0.0f;
+
+        for (int lag = minLag; lag <= maxLag; ++lag)
+        {
+            auto score = autocorrelation[(size_t)lag] * tempoPrior[(size_t)lag];
+
+            if (score > bestScore)
+            {
+                bestScore = score;
+                bestLag = lag;
+            }
+        }
+
+        auto period = (float)bestLag;
+
+        if (bestLag > minLag && bestLag < maxLag)
+        {
+            auto a = autocorrelation[(size_t)bestLag - 1], b = autocorrelation[(size_t)bestLag], c = autocorrelation[(size_t)bestLag + 1];
+            auto curvature = a - 2.0f * b + c;
+
+            if (curvature < 0.0f)
+                period += 0.5f * (a - c) / curvature;
+        }
+
+        // onsets landing at the same point of the cycle add up, so the angle of the sum marks the beat
+        beatAngle = std::fmod(beatAngle + juce::MathConstants<double>::twoPi / period, juce::MathConstants<double>::twoPi);
+        beatSum = phaseDecay * beatSum + x * std::polar(1.0f, -(float)beatAngle);
+
+        auto phase = (beatAngle + std::arg(beatSum)) / juce::MathConstants<double>::twoPi;
+
+        result.bpm = lagToBPM(period);
+        result.beatPhase = (float)(phase - std::floor(phase));
+        result.confidence = autocorrelation[0] > 0.0f ? juce::jlimit(0.0f, 1.0f, autocorrelation[(size_t)bestLag] / autocorrelation[0]) : 0.0f;
+    }
+
+    static float lagToBPM(float lag) noexcept { return 60.0f * (float)envelopeRate / lag; }
+};
@@ -23,6 +23,13 @@ struct BouncingNumber
         return (float)(v >= 1.0 ? (2.0 - v) : v);
     }
 
+    // Lock the bounce to the music, one full bounce per beat landing back on 0 at the beat
+    void syncToBeat(double beatPhase, double bpm)
+    {
+        speed = bpm / 30000.0;
+        phase = 2.0 * beatPhase - speed * juce::Time::getMillisecondCounterHiRes();
+    }
+
 protected:
     double speed = 0.0004 + 0.0007 * juce::Random::getSystemRandom().nextDouble(),
            phase = juce::Random::getSystemRandom().nextDouble();
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Reductions that juce::FloatVectorOperations doesn't provide.
+// Accumulating in independent lanes lets the compiler emit packed multiply-adds
+// without needing fast-math to reassociate the sum.
+namespace VectorOps
+{
+    static constexpr int numLanes = 8;
+
+    inline float dotProduct(const float *a, const float *b, int num) noexcept
+    {
+        float lanes[numLanes] = {};
+        int i = 0;
+
+        for (; i + numLanes <= num; i += numLanes)
+            for (int j = 0; j < numLanes; ++j)
+                lanes[j] += a[i + j] * b[i + j];
+
+        float total = 0.0f;
+
+        for (; i < num; ++i)
+            total += a[i] * b[i];
+
+        for (auto lane : lanes)
+            total += lane;
+
+        return total;
+    }
+
+    // sum of w[i] * a[i]^2, e.g. the power of a magnitude spectrum through band weights
+    inline float weightedSumOfSquares(const float *a, const float *w, int num) noexcept
+    {
+        float lanes[numLanes] = {};
+        int i = 0;
+
+        for (; i + numLanes <= num; i += numLanes)
+            for (int j = 0; j < numLanes; ++j)
+                lanes[j] += w[i + j] * a[i + j] * a[i + j];
+
+        float total = 0.0f;
+
+        for (; i < num; ++i)
+            total += w[i] * a[i] * a[i];
+
+        for (auto lane : lanes)
+            total += lane;
+
+        return total;
+    }
+
+    inline float sum(const float *a, int num) noexcept
+    {
+        float lanes[numLanes] = {};
+        int i = 0;
+
+        for (; i + numLanes <= num; i += numLanes)
+            for (int j = 0; j < numLanes; ++j)
+                lanes[j] += a[i + j];
+
+        float total = 0.0f;
+
+        for (; i < num; ++i)
+            total += a[i];
+
+        for (auto lane : lanes)
+            total += lane;
+
+        return total;
+    }
+}